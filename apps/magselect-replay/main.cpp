@@ -0,0 +1,178 @@
+#define SEISCOMP_COMPONENT MagSelectReplay
+
+#include <seiscomp/client/application.h>
+#include <seiscomp/datamodel/event.h>
+#include <seiscomp/datamodel/eventparameters.h>
+#include <seiscomp/datamodel/magnitude.h>
+#include <seiscomp/datamodel/origin.h>
+#include <seiscomp/io/archive/xmlarchive.h>
+#include <seiscomp/logging/log.h>
+#include <seiscomp/plugins/events/eventprocessor.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using Seiscomp::DataModel::Event;
+using Seiscomp::DataModel::EventParameters;
+using Seiscomp::DataModel::EventParametersPtr;
+using Seiscomp::DataModel::Magnitude;
+using Seiscomp::DataModel::Origin;
+
+/*
+Offline replay of the magselect rule set. Hosts an scevent event processor
+plugin (MagSelect by default) configured from scevent.cfg, feeds it the origins
+of an SCML catalogue through preferredMagnitude() and reports the selection
+for every event together with the evaluation throughput.
+
+Example:
+    magselect-replay --config-file scevent.cfg -i catalogue.xml --repeat 100
+*/
+class MagSelectReplay : public Seiscomp::Client::Application {
+public:
+    MagSelectReplay(int argc, char** argv)
+        : Application(argc, argv)
+    {
+        setMessagingEnabled(false);
+        setDatabaseEnabled(false, false);
+    }
+
+protected:
+    struct Target {
+        const Event* event;
+        const Origin* origin;
+    };
+
+    void createCommandLineDescription() override
+    {
+        commandline().addGroup("Replay");
+        commandline().addOption("Replay", "input,i", "SCML file with the events and origins to replay",
+            &_inputFile, false);
+        commandline().addOption("Replay", "processor",
+            "Name of the event processor to host", &_processorName);
+        commandline().addOption("Replay", "repeat",
+            "Number of passes over the catalogue, only the first pass is printed", &_repeat);
+        commandline().addOption("Replay", "all-origins",
+            "Evaluate every origin instead of only the preferred origin of each event");
+    }
+
+    bool validateParameters() override
+    {
+        if (_inputFile.empty()) {
+            std::fprintf(stderr, "No input given, use --input\n");
+            return false;
+        }
+        if (_repeat < 1)
+            _repeat = 1;
+        return true;
+    }
+
+    bool run() override
+    {
+        Seiscomp::IO::XMLArchive ar;
+        if (!ar.open(_inputFile.c_str())) {
+            SEISCOMP_ERROR("Could not open %s", _inputFile.c_str());
+            return false;
+        }
+
+        EventParametersPtr ep;
+        ar >> ep;
+        ar.close();
+
+        if (!ep) {
+            SEISCOMP_ERROR("No event parameters found in %s", _inputFile.c_str());
+            return false;
+        }
+
+        Seiscomp::Client::EventProcessorPtr proc
+            = Seiscomp::Client::EventProcessorFactory::Create(_processorName.c_str());
+        if (!proc) {
+            SEISCOMP_ERROR("Event processor %s is not available, is its plugin loaded?",
+                _processorName.c_str());
+            return false;
+        }
+
+        if (!proc->setup(configuration())) {
+            SEISCOMP_ERROR("Failed to set up event processor %s", _processorName.c_str());
+            return false;
+        }
+
+        const std::vector<Target> targets = collectTargets(ep.get());
+        if (targets.empty()) {
+            SEISCOMP_ERROR("Nothing to replay in %s", _inputFile.c_str());
+            return false;
+        }
+
+        size_t selected = 0;
+        std::chrono::steady_clock::duration elapsed {};
+
+        for (int pass = 0; pass < _repeat && !isExitRequested(); ++pass) {
+            for (const Target& target : targets) {
+                const auto start = std::chrono::steady_clock::now();
+                const Magnitude* mag = proc->preferredMagnitude(target.origin);
+                elapsed += std::chrono::steady_clock::now() - start;
+
+                if (pass > 0)
+                    continue;
+
+                if (mag)
+                    ++selected;
+
+                std::printf("%s %s %s", target.event ? target.event->publicID().c_str() : "-",
+                    target.origin->publicID().c_str(), mag ? mag->type().c_str() : "-");
+                if (mag)
+                    std::printf(" %.2f", mag->magnitude().value());
+                std::printf("\n");
+            }
+        }
+
+        // Releases the processor so that it reports its final statistics
+        proc = nullptr;
+
+        const double seconds = std::chrono::duration<double>(elapsed).count();
+        const double calls = double(targets.size()) * _repeat;
+        std::fprintf(stderr,
+            "%zu origin(s), %zu with a selection, %d pass(es)\n"
+            "%.0f evaluations in %.3f ms: %.2f us/origin, %.0f origins/s\n",
+            targets.size(), selected, _repeat, calls, seconds * 1000.0,
+            seconds * 1e6 / calls, seconds > 0 ? calls / seconds : 0.0);
+
+        return true;
+    }
+
+private:
+    std::vector<Target> collectTargets(const EventParameters* ep) const
+    {
+        std::vector<Target> targets;
+
+        if (commandline().hasOption("all-origins") || ep->eventCount() == 0) {
+            for (size_t i = 0; i < ep->originCount(); ++i)
+                targets.push_back({ nullptr, ep->origin(i) });
+            return targets;
+        }
+
+        for (size_t i = 0; i < ep->eventCount(); ++i) {
+            const Event* event = ep->event(i);
+            const Origin* origin = ep->findOrigin(event->preferredOriginID());
+            if (!origin) {
+                SEISCOMP_WARNING("%s: preferred origin %s not found, skipping",
+                    event->publicID().c_str(), event->preferredOriginID().c_str());
+                continue;
+            }
+            targets.push_back({ event, origin });
+        }
+
+        return targets;
+    }
+
+    std::string _inputFile;
+    std::string _processorName { "MagSelect" };
+    int _repeat { 1 };
+};
+
+int main(int argc, char** argv)
+{
+    MagSelectReplay app(argc, argv);
+    return app();
+}
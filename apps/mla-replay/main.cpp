@@ -0,0 +1,971 @@
+#define SEISCOMP_COMPONENT MLaReplay
+
+#include <seiscomp/client/application.h>
+#include <seiscomp/client/inventory.h>
+#include <seiscomp/core/genericrecord.h>
+#include <seiscomp/core/strings.h>
+#include <seiscomp/datamodel/arrival.h>
+#include <seiscomp/datamodel/configmodule.h>
+#include <seiscomp/datamodel/eventparameters.h>
+#include <seiscomp/datamodel/origin.h>
+#include <seiscomp/datamodel/parameterset.h>
+#include <seiscomp/datamodel/pick.h>
+#include <seiscomp/datamodel/utils.h>
+#include <seiscomp/io/archive/xmlarchive.h>
+#include <seiscomp/io/recordinput.h>
+#include <seiscomp/io/recordstream.h>
+#include <seiscomp/logging/log.h>
+#include <seiscomp/math/geo.h>
+#include <seiscomp/processing/amplitudeprocessor.h>
+#include <seiscomp/processing/magnitudeprocessor.h>
+#include <seiscomp/utils/keyvalues.h>
+
+#include <ga/core/networkmagnitude.h>
+#include <ga/dsp/lanefilter.h>
+
+#include "mla.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Seiscomp::Core::Time;
+using Seiscomp::DataModel::EventParameters;
+using Seiscomp::DataModel::EventParametersPtr;
+using Seiscomp::DataModel::Origin;
+using Seiscomp::DataModel::Pick;
+using Seiscomp::Processing::AmplitudeProcessor;
+using Seiscomp::Processing::AmplitudeProcessorPtr;
+using Seiscomp::Processing::MagnitudeProcessor;
+using Seiscomp::Processing::MagnitudeProcessorPtr;
+using Seiscomp::Record;
+using Seiscomp::RecordPtr;
+
+using Clock = std::chrono::steady_clock;
+
+/*
+Deterministic replay of recorded waveforms through the MLa amplitude
+processors. Creates one processor per pick of an SCML file and amplitude type,
+configured like scamp (global configuration and the bindings of the scamp
+setup), feeds them the records of a miniSEED file in end time order and
+reports per stream and amplitude type:
+
+- pick-to-amplitude: end time of the record that completed the amplitude
+  minus the pick time, in seconds of data time. Depends only on the input and
+  configuration, so it is identical between runs.
+- processing: wall clock time from handing that record to the processor to
+  the amplitude being emitted, in milliseconds.
+
+With --speed 1 records are released at the rate they were recorded, with
+larger values accordingly faster, with 0 (default) as fast as possible.
+
+With --lockstep the prefilter and Wood-Anderson simulation are taken out of
+the processors (Amplitude_MLA::setExternalFilter()) and run here for all
+streams with the same filter chain and sampling rate at once, in a
+GA::DSP::LaneFilter. Records whose end times lie within --lockstep-window
+seconds are filtered together, the filtered copies are then fed to the
+processors as usual. Types whose prefilter is not BW_HP(order, fc) or whose
+prefilter is not configured explicitly (the built-in defaults of the
+variants) keep filtering themselves.
+
+The --compare-* options run every processor a second time as a variant. The
+latency table then lists both runs and the maximum magnitude difference
+between them, |log10(A_variant/A_reference)|, is reported per amplitude type.
+With --max-dm the replay fails if that difference exceeds the given value for
+any type or if only one of both runs produced an amplitude for a pick, so
+that a comparison can serve as a check.
+
+--compare-lockstep runs every processor with its own and with the lockstep
+filter. The lockstep chain is designed here and not by SeisComP, so small
+differences are expected.
+
+--compare-decimation runs every processor a second time with
+amplitudes.<type>.decimationRate set to --decimation-rate (default 100 Hz)
+and reports the magnitude differences, to check the decimation front-end on
+high rate streams before enabling it.
+
+--compare-pooling runs every processor with amplitudes.<type>.pooling
+disabled and a second time enabled and reports the magnitude differences,
+which must be zero.
+
+--compare-precision runs every processor a second time with
+amplitudes.<type>.singlePrecision enabled, to validate the float filter path
+on the waveforms of the network before enabling it.
+
+--magnitudes computes the station magnitudes of every origin from the
+amplitudes of its arrivals once the data is replayed and prints them to stdout
+along with the network magnitude of each origin and type
+(GA::Core::NetworkMagnitude). All types are computed in one call of
+Magnitude_MLA::computeStationMagnitudes of the first type, on its
+magnitudes.<type>.threads threads, which evaluates the distance correction of
+a station once for all of its amplitudes. With a --compare-* option the
+amplitudes of the first run are used.
+
+The channel of each pick is used as the vertical component. Inventory and
+bindings are read from --inventory-db and --config-db.
+
+Example:
+    mla-replay --plugins mla --inventory-db inv.xml --config-db config.xml \
+        --picks picks.xml --records data.mseed --amplitudes MLa,MLa05
+*/
+class MLaReplay : public Seiscomp::Client::Application {
+public:
+    MLaReplay(int argc, char** argv)
+        : Application(argc, argv)
+    {
+        setMessagingEnabled(false);
+        setDatabaseEnabled(false, false);
+        setLoadInventoryEnabled(true);
+        setLoadConfigModuleEnabled(true);
+    }
+
+protected:
+    enum Variant { Reference, Lockstep, Decimated, Pooled, Single };
+
+    // Filter chain of the lockstep variant
+    struct Chain {
+        std::string preFilter;
+        double gain { 2800 };
+        double T0 { 0.8 };
+        double h { 0.8 };
+    };
+
+    struct Job {
+        AmplitudeProcessorPtr processor;
+        std::string key;
+        Time pickTime;
+        std::string pickID;
+        std::string type;
+        Variant variant;
+        Chain chain;
+        // Lane of the lockstep filter, assigned with the first record
+        GA::DSP::LaneFilter* lanes { nullptr };
+        size_t lane { 0 };
+        Time laneEnd;
+    };
+
+    // Final amplitudes of one pick and type, of the reference and the variant
+    struct Comparison {
+        double value[2] { -1, -1 };
+    };
+
+    // Final amplitude of one pick and type, for --magnitudes
+    struct Measured {
+        double amplitude { 0 };
+        double period { 0 };
+        double snr { 0 };
+    };
+
+    struct Latencies {
+        std::vector<double> pickToAmplitude;
+        std::vector<double> processing;
+        size_t processors { 0 };
+    };
+
+    void createCommandLineDescription() override
+    {
+        commandline().addGroup("Replay");
+        commandline().addOption("Replay", "picks", "SCML file with the picks and origins to replay",
+            &_pickFile, false);
+        commandline().addOption("Replay", "records", "miniSEED file with the waveforms",
+            &_recordFile, false);
+        commandline().addOption("Replay", "amplitudes",
+            "Comma separated list of amplitude types to compute", &_amplitudeTypes);
+        commandline().addOption("Replay", "speed",
+            "Replay speed relative to real time, 0 replays as fast as possible", &_speed);
+        commandline().addOption("Replay", "setup", "Name of the binding setup to use", &_setupName);
+        commandline().addOption("Replay", "print-amplitudes",
+            "Print every emitted amplitude to stdout");
+        commandline().addOption("Replay", "lockstep",
+            "Filter the streams of all processors together instead of in the processors");
+        commandline().addOption("Replay", "compare-lockstep",
+            "Run every processor with its own and with the lockstep filter and report the differences");
+        commandline().addOption("Replay", "lockstep-window",
+            "Records ending within this many seconds are filtered together", &_lockstepWindow);
+        commandline().addOption("Replay", "compare-decimation",
+            "Run every processor at the native and a decimated rate and report the differences");
+        commandline().addOption("Replay", "compare-pooling",
+            "Run every processor without and with pooling and report the differences");
+        commandline().addOption("Replay", "compare-precision",
+            "Run every processor in double and single precision and report the differences");
+        commandline().addOption("Replay", "decimation-rate",
+            "Target sampling rate of --compare-decimation in Hz", &_decimationRate);
+        commandline().addOption("Replay", "max-dm",
+            "Fail if a --compare-* run differs by more than this magnitude", &_maxDiff);
+        commandline().addOption("Replay", "magnitudes",
+            "Compute and print the station magnitudes of every origin from the amplitudes");
+    }
+
+    bool validateParameters() override
+    {
+        if (_pickFile.empty() || _recordFile.empty()) {
+            std::fprintf(stderr, "Picks and records are required, use --picks and --records\n");
+            return false;
+        }
+        if (_speed < 0)
+            _speed = 0;
+        if (commandline().hasOption("lockstep") + commandline().hasOption("compare-lockstep")
+                + commandline().hasOption("compare-decimation") + commandline().hasOption("compare-pooling")
+                + commandline().hasOption("compare-precision")
+            > 1) {
+            std::fprintf(stderr, "Use only one of --lockstep, --compare-lockstep, --compare-decimation, "
+                                 "--compare-pooling and --compare-precision\n");
+            return false;
+        }
+        if (commandline().hasOption("max-dm") && !comparing()) {
+            std::fprintf(stderr, "--max-dm requires one of the --compare-* options\n");
+            return false;
+        }
+        return true;
+    }
+
+    bool run() override
+    {
+        Seiscomp::IO::XMLArchive ar;
+        if (!ar.open(_pickFile.c_str())) {
+            SEISCOMP_ERROR("Could not open %s", _pickFile.c_str());
+            return false;
+        }
+
+        EventParametersPtr ep;
+        ar >> ep;
+        ar.close();
+
+        if (!ep) {
+            SEISCOMP_ERROR("No event parameters found in %s", _pickFile.c_str());
+            return false;
+        }
+
+        std::vector<RecordPtr> records;
+        if (!readRecords(records))
+            return false;
+
+        createJobs(ep.get());
+        if (_jobs.empty()) {
+            SEISCOMP_ERROR("No amplitude processor could be created");
+            return false;
+        }
+
+        replay(records);
+        report();
+        if (commandline().hasOption("magnitudes"))
+            reportMagnitudes(ep.get());
+        if (comparing() && !reportComparison())
+            return false;
+        return true;
+    }
+
+private:
+    bool comparing()
+    {
+        return commandline().hasOption("compare-lockstep") || commandline().hasOption("compare-decimation")
+            || commandline().hasOption("compare-pooling") || commandline().hasOption("compare-precision");
+    }
+
+    bool readRecords(std::vector<RecordPtr>& records) const
+    {
+        Seiscomp::IO::RecordStreamPtr rs = Seiscomp::IO::RecordStream::Open(("file://" + _recordFile).c_str());
+        if (!rs) {
+            SEISCOMP_ERROR("Could not open %s", _recordFile.c_str());
+            return false;
+        }
+
+        Seiscomp::IO::RecordInput input(rs.get(), Seiscomp::Array::DOUBLE, Record::DATA_ONLY);
+        for (Seiscomp::IO::RecordIterator it = input.begin(); it != input.end(); ++it)
+            records.push_back(*it);
+
+        // The order in the file depends on how it was written; sorting by end
+        // time, the time a record becomes available in real time, makes the
+        // replay independent of it.
+        std::stable_sort(records.begin(), records.end(), [](const RecordPtr& a, const RecordPtr& b) {
+            if (a->endTime() != b->endTime())
+                return a->endTime() < b->endTime();
+            return a->streamID() < b->streamID();
+        });
+
+        SEISCOMP_INFO("Read %d record(s) from %s", (int)records.size(), _recordFile.c_str());
+        return !records.empty();
+    }
+
+    void createJobs(EventParameters* ep)
+    {
+        // The origin an amplitude processor measures for, by pick
+        std::map<std::string, const Origin*> origins;
+        for (size_t i = 0; i < ep->originCount(); ++i) {
+            const Origin* origin = ep->origin(i);
+            for (size_t j = 0; j < origin->arrivalCount(); ++j)
+                origins.emplace(origin->arrival(j)->pickID(), origin);
+        }
+
+        std::vector<std::string> types;
+        Seiscomp::Core::split(types, _amplitudeTypes.c_str(), ",");
+
+        std::vector<Variant> variants { Reference };
+        if (commandline().hasOption("lockstep"))
+            variants = { Lockstep };
+        else if (commandline().hasOption("compare-lockstep"))
+            variants = { Reference, Lockstep };
+        else if (commandline().hasOption("compare-decimation"))
+            variants = { Reference, Decimated };
+        else if (commandline().hasOption("compare-pooling"))
+            variants = { Reference, Pooled };
+        else if (commandline().hasOption("compare-precision"))
+            variants = { Reference, Single };
+        _firstVariant = variants.front();
+
+        for (size_t i = 0; i < ep->pickCount(); ++i) {
+            Pick* pick = ep->pick(i);
+            auto it = origins.find(pick->publicID());
+            const Origin* origin = it != origins.end() ? it->second : nullptr;
+
+            for (std::string type : types) {
+                Seiscomp::Core::trim(type);
+                for (Variant variant : variants) {
+                    Job job;
+                    job.processor = createProcessor(type, pick, origin, variant, job.chain);
+                    if (!job.processor && variant == Lockstep) {
+                        // The processor filters itself if its prefilter cannot be
+                        // taken over
+                        variant = Reference;
+                        job.processor = createProcessor(type, pick, origin, variant, job.chain);
+                    }
+                    if (!job.processor)
+                        continue;
+
+                    static const char* const suffixes[] { "", " lanes", " dec", " pool", " f32" };
+                    job.key = streamID(pick) + " " + type + suffixes[variant];
+                    job.pickTime = pick->time().value();
+                    job.pickID = pick->publicID();
+                    job.type = type;
+                    job.variant = variant;
+                    _latencies[job.key].processors += 1;
+                    _jobs[streamID(pick)].push_back(job);
+                }
+            }
+        }
+    }
+
+    AmplitudeProcessorPtr createProcessor(
+        const std::string& type, const Pick* pick, const Origin* origin, Variant variant, Chain& chain)
+    {
+        const Seiscomp::DataModel::WaveformStreamID& id = pick->waveformID();
+
+        AmplitudeProcessorPtr proc = Seiscomp::Processing::AmplitudeProcessorFactory::Create(type.c_str());
+        if (!proc) {
+            SEISCOMP_ERROR("Amplitude type %s is not available, is its plugin loaded?", type.c_str());
+            return nullptr;
+        }
+
+        proc->streamConfig(Seiscomp::Processing::WaveformProcessor::VerticalComponent)
+            .init(id.networkCode(), id.stationCode(), id.locationCode(), id.channelCode(),
+                pick->time().value());
+
+        Seiscomp::Util::KeyValuesPtr keys = bindings(id.networkCode(), id.stationCode());
+        if (variant == Lockstep) {
+            Seiscomp::Processing::Settings settings(configModuleName(), id.networkCode(), id.stationCode(),
+                id.locationCode(), id.channelCode(), &configuration(), keys.get());
+            if (!lockstepChain(settings, type, chain))
+                return nullptr;
+        }
+        const bool comparePooling = commandline().hasOption("compare-pooling");
+        if (variant == Decimated || variant == Single || comparePooling) {
+            // Bindings take precedence over the global configuration
+            if (!keys)
+                keys = new Seiscomp::Util::KeyValues;
+            if (comparePooling)
+                keys->setString("amplitudes." + type + ".pooling", variant == Pooled ? "true" : "false");
+            else if (variant == Decimated)
+                keys->setString("amplitudes." + type + ".decimationRate", Seiscomp::Core::toString(_decimationRate));
+            else
+                keys->setString("amplitudes." + type + ".singlePrecision", "true");
+        }
+        Seiscomp::Processing::Settings settings(configModuleName(), id.networkCode(), id.stationCode(),
+            id.locationCode(), id.channelCode(), &configuration(), keys.get());
+        if (!proc->setup(settings)) {
+            SEISCOMP_WARNING("%s: setup of %s failed, skipping", pick->publicID().c_str(), type.c_str());
+            return nullptr;
+        }
+
+        if (variant == Lockstep) {
+            Amplitude_MLA* mla = asMLa(proc.get());
+            if (!mla || !mla->setExternalFilter(chain.preFilter)) {
+                SEISCOMP_DEBUG("%s: %s cannot use the lockstep filter", pick->publicID().c_str(), type.c_str());
+                return nullptr;
+            }
+        }
+
+        proc->setTrigger(pick->time().value());
+        proc->setReferencingPickID(pick->publicID());
+        proc->setEnvironment(origin, Seiscomp::Client::Inventory::Instance()->getSensorLocation(pick), pick);
+        proc->computeTimeWindow();
+        proc->setPublishFunction(
+            [this](const AmplitudeProcessor* p, const AmplitudeProcessor::Result& result) { emitted(p, result); });
+
+        if (proc->isFinished()) {
+            SEISCOMP_DEBUG("%s: %s finished before receiving data: %s", pick->publicID().c_str(),
+                type.c_str(), proc->status().toString());
+            return nullptr;
+        }
+
+        return proc;
+    }
+
+    // The processor as Amplitude_MLA if it is one or one of its variants. The
+    // plugin is loaded at runtime, so the class is identified by the names
+    // of its RTTI chain instead of dynamic_cast.
+    static Amplitude_MLA* asMLa(AmplitudeProcessor* proc)
+    {
+        return isA(proc, "Amplitude_MLA") ? static_cast<Amplitude_MLA*>(proc) : nullptr;
+    }
+
+    static Magnitude_MLA* asMLa(MagnitudeProcessor* proc)
+    {
+        return isA(proc, "Magnitude_MLA") ? static_cast<Magnitude_MLA*>(proc) : nullptr;
+    }
+
+    static bool isA(const Seiscomp::Core::BaseObject* object, const char* className)
+    {
+        for (const Seiscomp::Core::RTTI* info = &object->typeInfo(); info; info = info->parent()) {
+            if (std::string(info->className()) == className)
+                return true;
+        }
+        return false;
+    }
+
+    // Reads the prefilter the processor is configured with and the
+    // Wood-Anderson response. False if the lockstep filter cannot replace it.
+    static bool lockstepChain(const Seiscomp::Processing::Settings& settings, const std::string& type, Chain& chain)
+    {
+        try {
+            chain.preFilter = settings.getString("amplitudes." + type + ".filter");
+        } catch (...) {
+            // Only MLa is known to have no default prefilter
+            if (type != "MLa")
+                return false;
+            chain.preFilter.clear();
+        }
+
+        settings.getValue(chain.gain, "amplitudes.WoodAnderson.gain");
+        settings.getValue(chain.T0, "amplitudes.WoodAnderson.T0");
+        settings.getValue(chain.h, "amplitudes.WoodAnderson.h");
+
+        // The sampling rate is not known yet, any rate above the corner tells
+        // whether the prefilter is supported.
+        std::vector<GA::DSP::Biquad> sections;
+        return GA::DSP::designMLaChain(chain.preFilter, 1000.0, chain.gain, chain.T0, chain.h, sections);
+    }
+
+    Seiscomp::Util::KeyValuesPtr bindings(const std::string& net, const std::string& sta) const
+    {
+        Seiscomp::DataModel::ConfigModule* module = configModule();
+        for (size_t i = 0; module && i < module->configStationCount(); ++i) {
+            Seiscomp::DataModel::ConfigStation* station = module->configStation(i);
+            if (station->networkCode() != net || station->stationCode() != sta)
+                continue;
+
+            Seiscomp::DataModel::Setup* setup = Seiscomp::DataModel::findSetup(station, _setupName, true);
+            if (!setup)
+                continue;
+
+            Seiscomp::DataModel::ParameterSet* ps
+                = Seiscomp::DataModel::ParameterSet::Find(setup->parameterSetID());
+            if (!ps)
+                continue;
+
+            Seiscomp::Util::KeyValuesPtr keys = new Seiscomp::Util::KeyValues;
+            keys->init(ps);
+            return keys;
+        }
+
+        return nullptr;
+    }
+
+    void replay(const std::vector<RecordPtr>& records)
+    {
+        const bool lockstep = commandline().hasOption("lockstep") || commandline().hasOption("compare-lockstep");
+        const Time first = records.front()->endTime();
+        const Clock::time_point start = Clock::now();
+
+        std::vector<const Record*> batch;
+        for (size_t i = 0; i < records.size();) {
+            if (isExitRequested())
+                break;
+
+            // Without lockstep filtering every record is a batch of its own
+            batch.clear();
+            const Time end = records[i]->endTime();
+            do {
+                if (_jobs.count(records[i]->streamID()))
+                    batch.push_back(records[i].get());
+                ++i;
+            } while (lockstep && i < records.size()
+                && static_cast<double>(records[i]->endTime() - end) < _lockstepWindow);
+
+            if (batch.empty())
+                continue;
+
+            if (_speed > 0) {
+                const double offset = static_cast<double>(batch.back()->endTime() - first) / _speed;
+                std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(
+                                                          std::chrono::duration<double>(offset)));
+            }
+
+            if (lockstep)
+                feedLockstep(batch);
+            else
+                feed(batch.front(), nullptr);
+        }
+
+        // The end of the data: processors still waiting, e.g. for records
+        // behind a gap, finish with what they have
+        for (auto& item : _jobs) {
+            for (Job& job : item.second) {
+                _current = &job;
+                _fed = Clock::now();
+                job.processor->close();
+            }
+            item.second.erase(std::remove_if(item.second.begin(), item.second.end(),
+                                  [](const Job& job) { return job.processor->isFinished(); }),
+                item.second.end());
+        }
+        _current = nullptr;
+    }
+
+    // Filtered samples of one record for one lockstep job
+    struct Filtered {
+        Job* job;
+        std::vector<double> samples;
+        std::vector<double> state;
+    };
+
+    /*
+    Filters the records of a batch for all lockstep jobs on their streams,
+    one LaneFilter::apply() per filter chain and round, and feeds them. A
+    round holds at most one record per stream, as the lanes of a stream must
+    see its records in order.
+    */
+    void feedLockstep(const std::vector<const Record*>& batch)
+    {
+        std::map<std::string, size_t> occurrences;
+        std::vector<std::vector<const Record*>> rounds;
+        for (const Record* rec : batch) {
+            const size_t round = occurrences[rec->streamID()]++;
+            if (round >= rounds.size())
+                rounds.resize(round + 1);
+            rounds[round].push_back(rec);
+        }
+
+        for (const std::vector<const Record*>& round : rounds) {
+            std::map<const Record*, std::vector<Filtered>> filtered;
+            std::map<GA::DSP::LaneFilter*, std::vector<Filtered*>> chains;
+
+            for (const Record* rec : round) {
+                std::vector<Filtered>& items = filtered[rec];
+                for (Job& job : _jobs[rec->streamID()]) {
+                    if (job.variant != Lockstep || !assignLane(job, rec))
+                        continue;
+
+                    const Seiscomp::DoubleArray* data = Seiscomp::DoubleArray::ConstCast(rec->data());
+                    if (!data)
+                        continue;
+
+                    // A gap makes the processor start over with a fresh filter
+                    if (job.laneEnd.valid()
+                        && std::abs(static_cast<double>(rec->startTime() - job.laneEnd))
+                            > 0.5 / rec->samplingFrequency())
+                        job.lanes->reset(job.lane);
+
+                    items.push_back({ &job,
+                        std::vector<double>(data->typedData(), data->typedData() + data->size()),
+                        job.lanes->save(job.lane) });
+                }
+                for (Filtered& item : items)
+                    chains[item.job->lanes].push_back(&item);
+            }
+
+            for (auto& chain : chains) {
+                std::vector<size_t> lanes, n;
+                std::vector<double*> data;
+                for (Filtered* item : chain.second) {
+                    lanes.push_back(item->job->lane);
+                    data.push_back(item->samples.data());
+                    n.push_back(item->samples.size());
+                }
+                _filterCalls += 1;
+                _filterLanes += lanes.size();
+                chain.first->apply(lanes.size(), lanes.data(), data.data(), n.data());
+            }
+
+            for (const Record* rec : round)
+                feed(rec, &filtered[rec]);
+        }
+    }
+
+    // Assigns the lane of a lockstep job on its first record, false if the
+    // chain cannot be designed for the sampling rate.
+    bool assignLane(Job& job, const Record* rec)
+    {
+        if (job.lanes)
+            return true;
+
+        const double fsamp = rec->samplingFrequency();
+        const std::string key = job.chain.preFilter + "@" + Seiscomp::Core::toString(fsamp) + "/"
+            + Seiscomp::Core::toString(job.chain.gain) + "," + Seiscomp::Core::toString(job.chain.T0) + ","
+            + Seiscomp::Core::toString(job.chain.h);
+
+        std::unique_ptr<GA::DSP::LaneFilter>& lanes = _laneFilters[key];
+        if (!lanes) {
+            std::vector<GA::DSP::Biquad> sections;
+            if (!GA::DSP::designMLaChain(
+                    job.chain.preFilter, fsamp, job.chain.gain, job.chain.T0, job.chain.h, sections)) {
+                SEISCOMP_WARNING("%s: filter %s not supported at %g Hz", job.key.c_str(),
+                    job.chain.preFilter.c_str(), fsamp);
+                _laneFilters.erase(key);
+                return false;
+            }
+            lanes.reset(new GA::DSP::LaneFilter(sections));
+        }
+
+        job.lanes = lanes.get();
+        job.lane = lanes->addLane();
+        return true;
+    }
+
+    // Feeds a record to the processors of its stream, lockstep jobs get their
+    // filtered copy out of filtered.
+    void feed(const Record* rec, std::vector<Filtered>* filtered)
+    {
+        std::vector<Job>& jobs = _jobs[rec->streamID()];
+        for (Job& job : jobs) {
+            Seiscomp::GenericRecordPtr copy;
+            const Filtered* item = nullptr;
+            if (job.variant == Lockstep) {
+                for (size_t i = 0; filtered && i < filtered->size(); ++i) {
+                    if ((*filtered)[i].job == &job)
+                        item = &(*filtered)[i];
+                }
+                if (!item)
+                    continue;
+
+                copy = new Seiscomp::GenericRecord(rec->networkCode(), rec->stationCode(), rec->locationCode(),
+                    rec->channelCode(), rec->startTime(), rec->samplingFrequency());
+                copy->setData(new Seiscomp::DoubleArray(static_cast<int>(item->samples.size()), item->samples.data()));
+                copy->dataUpdated();
+            }
+
+            _current = &job;
+            _fed = Clock::now();
+            const bool accepted = job.processor->feed(copy ? copy.get() : rec);
+
+            if (item) {
+                // The processor filters only the records it accepts
+                if (accepted)
+                    job.laneEnd = rec->endTime();
+                else
+                    job.lanes->restore(job.lane, item->state);
+            }
+        }
+        _current = nullptr;
+
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(),
+                       [](const Job& job) { return job.processor->isFinished(); }),
+            jobs.end());
+    }
+
+    void emitted(const AmplitudeProcessor* proc, const AmplitudeProcessor::Result& result)
+    {
+        const Clock::time_point now = Clock::now();
+        // Asynchronous processors publish with the next record of any
+        // stream, not necessarily while being fed themselves
+        const Job* job = _current && _current->processor.get() == proc ? _current : findJob(proc);
+        if (!job)
+            return;
+
+        Latencies& latencies = _latencies[job->key];
+        latencies.processing.push_back(std::chrono::duration<double, std::milli>(now - _fed).count());
+        if (result.record)
+            latencies.pickToAmplitude.push_back(static_cast<double>(result.record->endTime() - job->pickTime));
+
+        Comparison& comparison = _comparisons[job->type][job->pickID];
+        comparison.value[job->variant == Reference ? 0 : 1] = result.amplitude.value;
+
+        if (job->variant == _firstVariant) {
+            Measured& measured = _measured[job->type][job->pickID];
+            measured.amplitude = result.amplitude.value;
+            measured.period = result.period;
+            measured.snr = result.snr;
+        }
+
+        if (commandline().hasOption("print-amplitudes"))
+            std::printf("%s %s %s %g %.2f\n", proc->referencingPickID().c_str(), job->key.c_str(),
+                result.time.reference.iso().c_str(), result.amplitude.value, result.snr);
+    }
+
+    const Job* findJob(const AmplitudeProcessor* proc) const
+    {
+        for (const auto& item : _jobs) {
+            for (const Job& job : item.second) {
+                if (job.processor.get() == proc)
+                    return &job;
+            }
+        }
+        return nullptr;
+    }
+
+    void report()
+    {
+        size_t pending = 0;
+        for (const auto& item : _jobs) {
+            for (const Job& job : item.second) {
+                ++pending;
+                SEISCOMP_DEBUG("%s: no amplitude, status %s", job.key.c_str(),
+                    job.processor->status().toString());
+            }
+        }
+
+        std::fprintf(stderr, "%-24s %5s %5s | %8s %8s %8s %8s | %8s %8s %8s %8s\n", "stream type", "procs",
+            "amps", "p50[s]", "p90[s]", "p99[s]", "max[s]", "p50[ms]", "p90[ms]", "p99[ms]", "max[ms]");
+        for (auto& item : _latencies) {
+            Latencies& l = item.second;
+            std::fprintf(stderr, "%-24s %5zu %5zu | %8.2f %8.2f %8.2f %8.2f | %8.3f %8.3f %8.3f %8.3f\n",
+                item.first.c_str(), l.processors, l.processing.size(), percentile(l.pickToAmplitude, 0.5),
+                percentile(l.pickToAmplitude, 0.9), percentile(l.pickToAmplitude, 0.99),
+                percentile(l.pickToAmplitude, 1.0), percentile(l.processing, 0.5), percentile(l.processing, 0.9),
+                percentile(l.processing, 0.99), percentile(l.processing, 1.0));
+        }
+        std::fprintf(stderr, "%zu processor(s) without amplitude at the end of the data\n", pending);
+        if (_filterCalls)
+            std::fprintf(stderr, "lockstep filter: %zu call(s), %.1f lanes per call\n", _filterCalls,
+                static_cast<double>(_filterLanes) / _filterCalls);
+    }
+
+    /*
+    Computes the station magnitudes of every origin and type from the
+    amplitudes of its arrivals and prints them, one line per station:
+        originID pickID type magnitude status
+    followed by the network magnitude of the stations with status OK, as
+    median and 25 % trimmed mean:
+        originID type median trimmedMean stationCount
+    All types are computed in one pass per origin by the processor of the
+    first type, whose regions, limits and minimum SNR apply to all of them.
+    The magnitude processors are set up from the global configuration.
+    */
+    void reportMagnitudes(EventParameters* ep)
+    {
+        std::vector<std::string> types;
+        Seiscomp::Core::split(types, _amplitudeTypes.c_str(), ",");
+
+        // The types with an MLa magnitude processor, the first one computes
+        // them all
+        MagnitudeProcessorPtr first;
+        std::vector<std::string> combined;
+        for (std::string type : types) {
+            Seiscomp::Core::trim(type);
+            MagnitudeProcessorPtr proc = Seiscomp::Processing::MagnitudeProcessorFactory::Create(type.c_str());
+            if (!proc) {
+                SEISCOMP_ERROR("Magnitude type %s is not available, is its plugin loaded?", type.c_str());
+                continue;
+            }
+
+            Seiscomp::Processing::Settings settings(configModuleName(), "", "", "", "", &configuration(), nullptr);
+            if (!asMLa(proc.get()) || !proc->setup(settings)) {
+                SEISCOMP_WARNING("Magnitude type %s cannot be computed in bulk, skipping", type.c_str());
+                continue;
+            }
+
+            if (!first)
+                first = proc;
+            combined.push_back(type);
+        }
+
+        if (!first)
+            return;
+
+        Magnitude_MLA* mla = asMLa(first.get());
+        for (size_t i = 0; i < ep->originCount(); ++i) {
+            const Origin* origin = ep->origin(i);
+            std::vector<std::string> picks;
+            std::vector<Magnitude_MLA::StationInput> inputs;
+            if (!stationInputs(origin, combined, picks, inputs))
+                continue;
+
+            const std::vector<Magnitude_MLA::StationMagnitude> magnitudes
+                = mla->computeStationMagnitudes(origin, inputs, combined.size());
+            for (size_t t = 0; t < combined.size(); ++t) {
+                GA::Core::NetworkMagnitude network;
+                for (size_t j = 0; j < picks.size(); ++j) {
+                    // Arrivals without an amplitude of the type
+                    if (inputs[j * combined.size() + t].amplitude <= 0)
+                        continue;
+
+                    const Magnitude_MLA::StationMagnitude& magnitude = magnitudes[j * combined.size() + t];
+                    std::printf("%s %s %s %.2f %s\n", origin->publicID().c_str(), picks[j].c_str(),
+                        combined[t].c_str(), magnitude.value, magnitude.status.toString());
+                    if (magnitude.status == MagnitudeProcessor::OK)
+                        network.set(picks[j], magnitude.value);
+                }
+
+                double median, trimmedMean;
+                if (network.median(&median) && network.trimmedMean(25, &trimmedMean)) {
+                    std::printf("%s %s %.2f %.2f %zu\n", origin->publicID().c_str(), combined[t].c_str(),
+                        median, trimmedMean, network.size());
+                }
+            }
+        }
+    }
+
+    // The inputs of the station magnitudes of an origin, one entry per type
+    // for every arrival with an amplitude of any of them, a missing amplitude
+    // as 0. False without any or without depth.
+    bool stationInputs(const Origin* origin, const std::vector<std::string>& types, std::vector<std::string>& picks,
+        std::vector<Magnitude_MLA::StationInput>& inputs) const
+    {
+        double depth;
+        try {
+            depth = origin->depth().value();
+        } catch (...) {
+            SEISCOMP_WARNING("%s: no depth, no magnitudes", origin->publicID().c_str());
+            return false;
+        }
+
+        for (size_t i = 0; i < origin->arrivalCount(); ++i) {
+            const Seiscomp::DataModel::Arrival* arrival = origin->arrival(i);
+            std::vector<const Measured*> measured;
+            bool any = false;
+            for (const std::string& type : types) {
+                auto amplitudes = _measured.find(type);
+                const Measured* m = nullptr;
+                if (amplitudes != _measured.end()) {
+                    auto it = amplitudes->second.find(arrival->pickID());
+                    if (it != amplitudes->second.end())
+                        m = &it->second;
+                }
+                measured.push_back(m);
+                any = any || m;
+            }
+
+            double delta;
+            if (!any || !distance(origin, arrival, delta))
+                continue;
+
+            picks.push_back(arrival->pickID());
+            for (const Measured* m : measured) {
+                if (m)
+                    inputs.push_back({ m->amplitude, m->period, m->snr, delta, depth });
+                else
+                    inputs.push_back({ 0, 0, 0, delta, depth });
+            }
+        }
+
+        return !inputs.empty();
+    }
+
+    // Epicentral distance of an arrival in degrees, from the station
+    // coordinates if the arrival has none
+    static bool distance(const Origin* origin, const Seiscomp::DataModel::Arrival* arrival, double& delta)
+    {
+        try {
+            delta = arrival->distance();
+            return true;
+        } catch (...) {
+        }
+
+        const Pick* pick = Pick::Find(arrival->pickID());
+        const Seiscomp::DataModel::SensorLocation* location
+            = pick ? Seiscomp::Client::Inventory::Instance()->getSensorLocation(pick) : nullptr;
+        if (!location)
+            return false;
+
+        try {
+            double az, baz;
+            Seiscomp::Math::Geo::delazi(origin->latitude().value(), origin->longitude().value(),
+                location->latitude(), location->longitude(), &delta, &az, &baz);
+            return true;
+        } catch (...) {
+            return false;
+        }
+    }
+
+    // Prints the differences per type, false if they exceed --max-dm
+    bool reportComparison() const
+    {
+        bool passed = true;
+        std::fprintf(stderr, "%-12s %6s %8s %14s\n", "type", "pairs", "missing", "max |dM|");
+        for (const auto& item : _comparisons) {
+            size_t pairs = 0, missing = 0;
+            double maxDiff = 0;
+            for (const auto& pick : item.second) {
+                const Comparison& c = pick.second;
+                if (c.value[0] <= 0 || c.value[1] <= 0) {
+                    // Only one of both produced an amplitude
+                    if (c.value[0] > 0 || c.value[1] > 0)
+                        ++missing;
+                    continue;
+                }
+                ++pairs;
+                maxDiff = std::max(maxDiff, std::abs(std::log10(c.value[1] / c.value[0])));
+            }
+            std::fprintf(stderr, "%-12s %6zu %8zu %14.6f\n", item.first.c_str(), pairs, missing, maxDiff);
+            if (_maxDiff >= 0 && (maxDiff > _maxDiff || missing > 0))
+                passed = false;
+        }
+
+        if (!passed)
+            std::fprintf(stderr, "magnitude differences exceed --max-dm %g\n", _maxDiff);
+        return passed;
+    }
+
+    // Nearest rank percentile, 0 for an empty sample
+    static double percentile(std::vector<double>& values, double p)
+    {
+        if (values.empty())
+            return 0;
+        std::sort(values.begin(), values.end());
+        size_t rank = static_cast<size_t>(p * values.size() + 0.999999);
+        return values[std::min(std::max(rank, size_t(1)), values.size()) - 1];
+    }
+
+    static std::string streamID(const Pick* pick)
+    {
+        const Seiscomp::DataModel::WaveformStreamID& id = pick->waveformID();
+        return id.networkCode() + "." + id.stationCode() + "." + id.locationCode() + "." + id.channelCode();
+    }
+
+    std::string _pickFile;
+    std::string _recordFile;
+    std::string _amplitudeTypes { "MLa" };
+    std::string _setupName { "scamp" };
+    double _speed { 0 };
+    double _lockstepWindow { 1.0 };
+    double _decimationRate { 100.0 };
+    // Tolerance of the --compare-* options, negative if not checked
+    double _maxDiff { -1 };
+
+    // Active processors by stream ID
+    std::map<std::string, std::vector<Job>> _jobs;
+    // Latencies by stream and amplitude type
+    std::map<std::string, Latencies> _latencies;
+    // Amplitudes by type and pick ID, for the --compare-* options
+    std::map<std::string, std::map<std::string, Comparison>> _comparisons;
+    // Amplitudes of the first run by type and pick ID, for --magnitudes
+    std::map<std::string, std::map<std::string, Measured>> _measured;
+    Variant _firstVariant { Reference };
+    // Lockstep filters by chain and sampling rate
+    std::map<std::string, std::unique_ptr<GA::DSP::LaneFilter>> _laneFilters;
+    size_t _filterCalls { 0 };
+    size_t _filterLanes { 0 };
+    const Job* _current { nullptr };
+    Clock::time_point _fed;
+};
+
+int main(int argc, char** argv)
+{
+    MLaReplay app(argc, argv);
+    return app();
+}
@@ -0,0 +1,328 @@
+#define SEISCOMP_COMPONENT SCEventReplay
+
+#include <seiscomp/client/application.h>
+#include <seiscomp/core/strings.h>
+#include <seiscomp/datamodel/event.h>
+#include <seiscomp/datamodel/eventparameters.h>
+#include <seiscomp/datamodel/magnitude.h>
+#include <seiscomp/datamodel/origin.h>
+#include <seiscomp/datamodel/originreference.h>
+#include <seiscomp/io/archive/xmlarchive.h>
+#include <seiscomp/logging/log.h>
+#include <seiscomp/plugins/events/eventprocessor.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using Seiscomp::Core::Time;
+using Seiscomp::DataModel::Event;
+using Seiscomp::DataModel::EventParameters;
+using Seiscomp::DataModel::EventParametersPtr;
+using Seiscomp::DataModel::Magnitude;
+using Seiscomp::DataModel::Origin;
+
+using Clock = std::chrono::steady_clock;
+
+/*
+Hosts the scevent event processor plugins (EQNamer and MagSelect by default)
+configured from scevent.cfg and replays the origins of an SCML file through
+them in scevent's call order, without messaging. Every origin is one update
+of the event referencing it, in creation time order:
+
+1. preferredMagnitude(origin) of every processor, in the order given by
+   --processors; the first magnitude returned becomes the preferred one,
+2. the origin becomes the preferred origin of the event,
+3. process(event, isNewEvent, journal) of every processor.
+
+Reports latency percentiles per processor and call and for the whole update,
+and the resident memory after every pass. --repeat replays the stream several
+times (soak run); memory that keeps growing after the first pass points at a
+leak or an unbounded cache. Latencies are counted in histograms allocated up
+front, so the replay itself does not grow with the number of passes; the
+percentiles are the upper bin edges, within 1 % of the measured values.
+
+Example:
+    scevent-replay --plugins eqnamer,magselect --config-file scevent.cfg \
+        -i events.xml --repeat 1000
+*/
+class SCEventReplay : public Seiscomp::Client::Application {
+public:
+    SCEventReplay(int argc, char** argv)
+        : Application(argc, argv)
+    {
+        setMessagingEnabled(false);
+        setDatabaseEnabled(false, false);
+    }
+
+protected:
+    struct Update {
+        Event* event;
+        Origin* origin;
+    };
+
+    // Latencies in microseconds, in logarithmic bins of 1 % width from
+    // Min to Min * 10^Decades. Values outside are counted in the first or
+    // last bin, the maximum is kept exactly.
+    class Histogram {
+    public:
+        Histogram()
+            : _counts(Decades * BinsPerDecade, 0)
+        {
+        }
+
+        void add(double value)
+        {
+            const double bin = std::log10(std::max(value, Min) / Min) * BinsPerDecade;
+            ++_counts[std::min(static_cast<size_t>(bin), _counts.size() - 1)];
+            ++_count;
+            _max = std::max(_max, value);
+        }
+
+        uint64_t count() const { return _count; }
+
+        // Nearest rank percentile, 0 for an empty sample
+        double percentile(double p) const
+        {
+            if (_count == 0)
+                return 0;
+            const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(p * _count)), 1);
+            uint64_t seen = 0;
+            for (size_t i = 0; i < _counts.size(); ++i) {
+                seen += _counts[i];
+                if (seen >= rank)
+                    return std::min(Min * std::pow(10.0, double(i + 1) / BinsPerDecade), _max);
+            }
+            return _max;
+        }
+
+    private:
+        static constexpr double Min = 0.01;
+        static constexpr int Decades = 10;
+        static constexpr int BinsPerDecade = 232; // 10^(1/232) = 1.01
+
+        std::vector<uint64_t> _counts;
+        uint64_t _count { 0 };
+        double _max { 0 };
+    };
+
+    struct Hosted {
+        std::string name;
+        Seiscomp::Client::EventProcessorPtr processor;
+        Histogram preferredMagnitude;
+        Histogram process;
+    };
+
+    void createCommandLineDescription() override
+    {
+        commandline().addGroup("Replay");
+        commandline().addOption("Replay", "input,i", "SCML file with the events, origins and magnitudes",
+            &_inputFile, false);
+        commandline().addOption("Replay", "processors",
+            "Comma separated list of the event processors to host, in call order", &_processorNames);
+        commandline().addOption("Replay", "repeat", "Number of passes over the updates", &_repeat);
+    }
+
+    bool validateParameters() override
+    {
+        if (_inputFile.empty()) {
+            std::fprintf(stderr, "No input given, use --input\n");
+            return false;
+        }
+        if (_repeat < 1)
+            _repeat = 1;
+        return true;
+    }
+
+    bool run() override
+    {
+        Seiscomp::IO::XMLArchive ar;
+        if (!ar.open(_inputFile.c_str())) {
+            SEISCOMP_ERROR("Could not open %s", _inputFile.c_str());
+            return false;
+        }
+
+        EventParametersPtr ep;
+        ar >> ep;
+        ar.close();
+
+        if (!ep) {
+            SEISCOMP_ERROR("No event parameters found in %s", _inputFile.c_str());
+            return false;
+        }
+
+        if (!createProcessors())
+            return false;
+
+        const std::vector<Update> updates = collectUpdates(ep.get());
+        if (updates.empty()) {
+            SEISCOMP_ERROR("No origin of %s is referenced by an event", _inputFile.c_str());
+            return false;
+        }
+
+        Histogram total;
+        std::vector<size_t> memory;
+        memory.reserve(_repeat + 1);
+        memory.push_back(residentMemory());
+
+        for (int pass = 0; pass < _repeat && !isExitRequested(); ++pass) {
+            std::set<const Event*> seen;
+            for (const Update& update : updates) {
+                const bool isNewEvent = seen.insert(update.event).second;
+                const Clock::time_point start = Clock::now();
+                replay(update, isNewEvent);
+                total.add(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+            }
+            memory.push_back(residentMemory());
+        }
+
+        // Releases the processors so that they report their final statistics
+        std::vector<Hosted> hosted;
+        hosted.swap(_hosted);
+        for (Hosted& h : hosted)
+            h.processor = nullptr;
+
+        std::fprintf(stderr, "%zu update(s) of %zu event(s), %d pass(es)\n", updates.size(),
+            ep->eventCount(), _repeat);
+        std::fprintf(stderr, "%-32s %8s | %9s %9s %9s %9s\n", "call", "calls", "p50[us]", "p90[us]",
+            "p99[us]", "max[us]");
+        for (Hosted& h : hosted) {
+            printLatencies(h.name + "::preferredMagnitude", h.preferredMagnitude);
+            printLatencies(h.name + "::process", h.process);
+        }
+        printLatencies("update", total);
+
+        std::fprintf(stderr, "resident memory [kB]: start %zu", memory.front() / 1024);
+        if (memory.size() > 1)
+            std::fprintf(stderr, ", after pass 1 %zu, end %zu", memory[1] / 1024, memory.back() / 1024);
+        if (memory.size() > 2)
+            std::fprintf(stderr, ", growth after pass 1 %.1f kB/pass",
+                (static_cast<double>(memory.back()) - memory[1]) / 1024.0 / (memory.size() - 2));
+        std::fprintf(stderr, "\n");
+
+        return true;
+    }
+
+private:
+    bool createProcessors()
+    {
+        std::vector<std::string> names;
+        Seiscomp::Core::split(names, _processorNames.c_str(), ",");
+
+        for (std::string name : names) {
+            Seiscomp::Core::trim(name);
+            Seiscomp::Client::EventProcessorPtr proc
+                = Seiscomp::Client::EventProcessorFactory::Create(name.c_str());
+            if (!proc) {
+                SEISCOMP_ERROR("Event processor %s is not available, is its plugin loaded?", name.c_str());
+                return false;
+            }
+
+            if (!proc->setup(configuration())) {
+                SEISCOMP_ERROR("Failed to set up event processor %s", name.c_str());
+                return false;
+            }
+
+            _hosted.push_back({ name, proc, Histogram(), Histogram() });
+        }
+
+        return !_hosted.empty();
+    }
+
+    void replay(const Update& update, bool isNewEvent)
+    {
+        const Magnitude* preferred = nullptr;
+        for (Hosted& h : _hosted) {
+            const Clock::time_point start = Clock::now();
+            const Magnitude* mag = h.processor->preferredMagnitude(update.origin);
+            h.preferredMagnitude.add(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+            if (!preferred)
+                preferred = mag;
+        }
+
+        update.event->setPreferredOriginID(update.origin->publicID());
+        if (preferred)
+            update.event->setPreferredMagnitudeID(preferred->publicID());
+
+        const Seiscomp::Client::EventProcessor::Journal journal;
+        for (Hosted& h : _hosted) {
+            const Clock::time_point start = Clock::now();
+            h.processor->process(update.event, isNewEvent, journal);
+            h.process.add(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+    }
+
+    // Origins referenced by an event, by creation time (origin time if not set)
+    static std::vector<Update> collectUpdates(EventParameters* ep)
+    {
+        std::map<std::string, Event*> events;
+        for (size_t i = 0; i < ep->eventCount(); ++i) {
+            Event* event = ep->event(i);
+            for (size_t j = 0; j < event->originReferenceCount(); ++j)
+                events.emplace(event->originReference(j)->originID(), event);
+        }
+
+        std::vector<std::pair<Time, Update>> updates;
+        for (size_t i = 0; i < ep->originCount(); ++i) {
+            Origin* origin = ep->origin(i);
+            auto it = events.find(origin->publicID());
+            if (it == events.end())
+                continue;
+
+            Time created;
+            try {
+                created = origin->creationInfo().creationTime();
+            } catch (...) {
+                created = origin->time().value();
+            }
+            updates.push_back({ created, { it->second, origin } });
+        }
+
+        std::stable_sort(updates.begin(), updates.end(),
+            [](const std::pair<Time, Update>& a, const std::pair<Time, Update>& b) { return a.first < b.first; });
+
+        std::vector<Update> result;
+        for (const auto& item : updates)
+            result.push_back(item.second);
+        return result;
+    }
+
+    static void printLatencies(const std::string& name, const Histogram& values)
+    {
+        std::fprintf(stderr, "%-32s %8llu | %9.1f %9.1f %9.1f %9.1f\n", name.c_str(),
+            static_cast<unsigned long long>(values.count()), values.percentile(0.5), values.percentile(0.9),
+            values.percentile(0.99), values.percentile(1.0));
+    }
+
+    // Resident set size in bytes, 0 if unknown
+    static size_t residentMemory()
+    {
+        FILE* f = std::fopen("/proc/self/statm", "r");
+        if (!f)
+            return 0;
+
+        unsigned long size = 0, resident = 0;
+        const bool ok = std::fscanf(f, "%lu %lu", &size, &resident) == 2;
+        std::fclose(f);
+        return ok ? resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+    }
+
+    std::string _inputFile;
+    std::string _processorNames { "EQNAMER,MagSelect" };
+    int _repeat { 1 };
+    std::vector<Hosted> _hosted;
+};
+
+int main(int argc, char** argv)
+{
+    SCEventReplay app(argc, argv);
+    return app();
+}
@@ -0,0 +1,218 @@
+#include "alloc.h"
+
+#include <seiscomp/logging/log.h>
+
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <new>
+
+namespace GA {
+namespace Alloc {
+
+namespace {
+
+// Operation whose scope is innermost on this thread, if any
+thread_local Counters* t_current = nullptr;
+
+// Allocations through the counting operator new, to tell whether it is in use
+std::atomic<uint64_t> s_allocations { 0 };
+
+using Clock = std::chrono::steady_clock;
+
+class Registry {
+public:
+    static Registry& Instance()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    ~Registry()
+    {
+        // The logging may be gone already
+        write(nullptr);
+    }
+
+    Counters* add(const char* category, const char* name)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _counters.emplace_back();
+        Counters& c = _counters.back();
+        c.category = category;
+        c.name = name;
+        return &c;
+    }
+
+    void maybeReport()
+    {
+        if (Clock::now() < _nextReport.load(std::memory_order_relaxed))
+            return;
+        report();
+    }
+
+    void report()
+    {
+        std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+        if (!lock)
+            return;
+        _nextReport = Clock::now() + _interval;
+        lock.unlock();
+        write(&Registry::log);
+    }
+
+private:
+    Registry()
+    {
+        const char* interval = std::getenv("GA_ALLOC_REPORT_INTERVAL");
+        const double seconds = interval ? std::atof(interval) : 0;
+        _interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(seconds > 0 ? seconds : 60.0));
+        _nextReport = Clock::now() + _interval;
+    }
+
+    static void log(const char* line) { SEISCOMP_INFO("%s", line); }
+
+    // Writes one line per operation through out, or to stderr if null.
+    void write(void (*out)(const char*))
+    {
+        // The report's own allocations belong to no operation
+        Counters* current = t_current;
+        t_current = nullptr;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        char line[256];
+        if (s_allocations == 0) {
+            std::snprintf(line, sizeof(line),
+                "ga_alloc: allocations are not counted, preload libga_alloc.so");
+            out ? out(line) : (void)std::fprintf(stderr, "%s\n", line);
+        }
+
+        for (const Counters& c : _counters) {
+            const uint64_t calls = c.calls, allocations = c.allocations, bytes = c.bytes;
+            std::snprintf(line, sizeof(line),
+                "ga_alloc: %s %s: %llu call(s), %llu allocation(s) %.1f/call, %llu bytes %.0f/call",
+                c.category, c.name, static_cast<unsigned long long>(calls),
+                static_cast<unsigned long long>(allocations), calls ? double(allocations) / calls : 0.0,
+                static_cast<unsigned long long>(bytes), calls ? double(bytes) / calls : 0.0);
+            out ? out(line) : (void)std::fprintf(stderr, "%s\n", line);
+        }
+
+        t_current = current;
+    }
+
+    std::mutex _mutex;
+    std::deque<Counters> _counters;
+    Clock::duration _interval;
+    std::atomic<Clock::time_point> _nextReport;
+};
+
+inline void count(std::size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (Counters* c = t_current) {
+        c->allocations.fetch_add(1, std::memory_order_relaxed);
+        c->bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+void* allocate(std::size_t size)
+{
+    count(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* allocateAligned(std::size_t size, std::align_val_t alignment)
+{
+    count(size);
+    void* p = nullptr;
+    const std::size_t align = std::max(static_cast<std::size_t>(alignment), sizeof(void*));
+    return posix_memalign(&p, align, size ? size : 1) == 0 ? p : nullptr;
+}
+
+} // namespace
+
+Counters* counters(const char* category, const char* name)
+{
+    return Registry::Instance().add(category, name);
+}
+
+Scope::Scope(Counters* counters)
+    : _previous(t_current)
+{
+    counters->calls.fetch_add(1, std::memory_order_relaxed);
+    t_current = counters;
+}
+
+Scope::~Scope()
+{
+    t_current = _previous;
+    if (!_previous)
+        Registry::Instance().maybeReport();
+}
+
+void report() { Registry::Instance().report(); }
+
+} // namespace Alloc
+} // namespace GA
+
+// Replacements of the global allocation functions. They only take effect for
+// the whole process if this library is preloaded.
+
+void* operator new(std::size_t size)
+{
+    if (void* p = GA::Alloc::allocate(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    if (void* p = GA::Alloc::allocate(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return GA::Alloc::allocate(size); }
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return GA::Alloc::allocate(size); }
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void* p = GA::Alloc::allocateAligned(size, alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    if (void* p = GA::Alloc::allocateAligned(size, alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return GA::Alloc::allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return GA::Alloc::allocateAligned(size, alignment);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
@@ -0,0 +1,90 @@
+/*
+ * File:   alloc.h
+ */
+
+#ifndef __GA_ALLOC_ALLOC_H__
+#define __GA_ALLOC_ALLOC_H__
+
+/*
+Allocation accounting for the GA plugins.
+
+Built only with the CMake option GA_ALLOC_TRACKING. Without it
+GA_ALLOC_SCOPE expands to an empty statement and the plugins do not link the
+library.
+
+    void Processor::compute()
+    {
+        GA_ALLOC_SCOPE("mla", "Processor::compute");
+        ...
+    }
+
+Every call of an instrumented operation is counted, together with the heap
+allocations (operator new, all forms) and bytes requested on the calling
+thread while it runs. Nested scopes count exclusively: an allocation belongs
+to the innermost scope only. Totals since the start of the process and their
+averages per call are logged every GA_ALLOC_REPORT_INTERVAL seconds (default
+60) and written to stderr when the process exits.
+
+The counting operator new lives in the shared library libga_alloc, which has
+to be preloaded to replace the one of the C++ runtime for the whole process:
+
+    LD_PRELOAD=libga_alloc.so scevent ...
+
+Without it the calls are still counted, the report says that allocations are
+not.
+*/
+
+#ifdef GA_ALLOC_TRACKING
+
+#include <atomic>
+#include <cstdint>
+
+namespace GA {
+namespace Alloc {
+
+struct Counters {
+    const char* category;
+    const char* name;
+    std::atomic<uint64_t> calls { 0 };
+    std::atomic<uint64_t> allocations { 0 };
+    std::atomic<uint64_t> bytes { 0 };
+};
+
+// Returns the counters of an operation, registering it on first use. Both
+// strings must outlive the process, i.e. be literals.
+Counters* counters(const char* category, const char* name);
+
+class Scope {
+public:
+    explicit Scope(Counters* counters);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    Counters* _previous;
+};
+
+// Logs the totals of all operations.
+void report();
+
+} // namespace Alloc
+} // namespace GA
+
+#define GA_ALLOC_CONCAT_(a, b) a##b
+#define GA_ALLOC_CONCAT(a, b) GA_ALLOC_CONCAT_(a, b)
+#define GA_ALLOC_SCOPE(category, name)                                                             \
+    static ::GA::Alloc::Counters* const GA_ALLOC_CONCAT(gaAllocCounters, __LINE__)                  \
+        = ::GA::Alloc::counters(category, name);                                                   \
+    ::GA::Alloc::Scope GA_ALLOC_CONCAT(gaAllocScope, __LINE__)(GA_ALLOC_CONCAT(gaAllocCounters, __LINE__))
+
+#else
+
+#define GA_ALLOC_SCOPE(category, name) \
+    do {                               \
+    } while (0)
+
+#endif
+
+#endif /* __GA_ALLOC_ALLOC_H__ */
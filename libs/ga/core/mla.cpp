@@ -0,0 +1,62 @@
+#include "mla.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace GA {
+namespace Core {
+namespace MLa {
+
+bool regionByName(const std::string& name, Region& region)
+{
+    if (name == "West")
+        region = Region::West;
+    else if (name == "East")
+        region = Region::East;
+    else if (name == "South")
+        region = Region::South;
+    else
+        return false;
+    return true;
+}
+
+double hypocentralDistance(double epicentralDistance, double depth)
+{
+    return std::sqrt(std::pow(depth, 2) + std::pow(epicentralDistance, 2));
+}
+
+double correctionWest(double r) { return (1.137 * std::log10(r)) + (0.000657 * r) + 0.66; }
+
+double correctionEast(double r)
+{
+    return (1.34 * std::log10(r / 100)) + (0.00055 * (r - 100)) + 3.13;
+}
+
+double correctionSouth(double r) { return (1.1 * std::log10(r)) + (0.0013 * r) + 0.7; }
+
+double correction(Region region, double r)
+{
+    switch (region) {
+    case Region::West:
+        return correctionWest(r);
+    case Region::East:
+        return correctionEast(r);
+    case Region::South:
+        return correctionSouth(r);
+    }
+    return NAN;
+}
+
+double smallestCorrection(double r)
+{
+    return std::min(correctionWest(r), std::min(correctionEast(r), correctionSouth(r)));
+}
+
+double magnitude(Region region, double amplitude, double r)
+{
+    return std::log10(amplitude) + correction(region, r);
+}
+
+} // namespace MLa
+} // namespace Core
+} // namespace GA
@@ -0,0 +1,47 @@
+/*
+ * File:   mla.h
+ */
+
+#ifndef __GA_CORE_MLA_H__
+#define __GA_CORE_MLA_H__
+
+#include <string>
+
+namespace GA {
+namespace Core {
+namespace MLa {
+
+/*
+The regional MLa formulas,
+    MLa = log10(A) + correction(R),
+with A the zero-to-peak Wood-Anderson amplitude in millimetres and R the
+hypocentral distance in kilometres. The corrections (-log A0 terms) are
+    West:  1.137log10(R)+0.000657*R+0.66       (Western Australia)
+    East:  1.34log10(R/100)+0.00055*(R-100)+3.13 (Eastern Australia)
+    South: 1.1log10(R)+0.0013*R+0.7            (Flinders Ranges)
+*/
+enum class Region { West, East, South };
+
+// Region of a name in the MLa region file, false for unknown names.
+bool regionByName(const std::string& name, Region& region);
+
+// Hypocentral distance R in kilometres from the epicentral distance and the
+// depth, both in kilometres.
+double hypocentralDistance(double epicentralDistance, double depth);
+
+double correctionWest(double r);
+double correctionEast(double r);
+double correctionSouth(double r);
+double correction(Region region, double r);
+
+// The smallest correction of all regions at distance r.
+double smallestCorrection(double r);
+
+// MLa of an amplitude in millimetres at hypocentral distance r.
+double magnitude(Region region, double amplitude, double r);
+
+} // namespace MLa
+} // namespace Core
+} // namespace GA
+
+#endif /* __GA_CORE_MLA_H__ */
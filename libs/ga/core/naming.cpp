@@ -0,0 +1,111 @@
+#include "naming.h"
+
+namespace GA {
+namespace Core {
+
+std::string compassDirection(double azi)
+{
+    if (azi < 22.5 || azi > 360.0 - 22.5)
+        return "N";
+    else if (azi >= 22.5 && azi <= 90.0 - 22.5)
+        return "NE";
+    else if (azi > 90.0 - 22.5 && azi < 90.0 + 22.5)
+        return "E";
+    else if (azi >= 90.0 + 22.5 && azi <= 180.0 - 22.5)
+        return "SE";
+    else if (azi > 180.0 - 22.5 && azi < 180.0 + 22.5)
+        return "S";
+    else if (azi >= 180.0 + 22.5 && azi <= 270.0 - 22.5)
+        return "SW";
+    else if (azi > 270.0 - 22.5 && azi < 270.0 + 22.5)
+        return "W";
+    else if (azi >= 270.0 + 22.5 && azi <= 360.0 - 22.5)
+        return "NW";
+    return "?";
+}
+
+std::string crustLabel(const std::string& crustType)
+{
+    if (crustType == "Coastal")
+        return "Coastal";
+    else if (crustType == "Oceanic")
+        return "Offshore";
+    return "";
+}
+
+std::string epicentreDescription(
+    const std::string& country, const std::string& homeCountry, const std::string& crustLabel)
+{
+    if (country.empty() || country == homeCountry)
+        return crustLabel;
+    if (crustLabel.empty())
+        return country;
+    return crustLabel + " " + country;
+}
+
+NameVariables::NameVariables(int distance, double azimuth, const std::string& place,
+    const std::string& placeCountry, const std::string& epicentre)
+    : _distance(distance)
+    , _direction(compassDirection(azimuth))
+    , _place(place)
+    , _placeCountry(placeCountry)
+    , _epicentre(epicentre)
+{
+}
+
+bool NameVariables::resolve(std::string& variable) const
+{
+    if (variable == "dist")
+        variable = std::to_string(_distance);
+    else if (variable == "dir")
+        variable = _direction;
+    else if (variable == "poi")
+        variable = _place;
+    else if (variable == "poi_country")
+        variable = _placeCountry;
+    else if (variable == "epi_description")
+        variable = _epicentre;
+    else
+        return false;
+
+    return true;
+}
+
+std::string expand(const std::string& text, const NameVariables& variables)
+{
+    std::string result;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const size_t start = text.find('@', pos);
+        if (start == std::string::npos) {
+            result.append(text, pos, std::string::npos);
+            break;
+        }
+        result.append(text, pos, start - pos);
+
+        const size_t end = text.find('@', start + 1);
+        if (end == std::string::npos) {
+            result.append(text, start, std::string::npos);
+            break;
+        }
+
+        std::string variable = text.substr(start + 1, end - start - 1);
+        if (variable.empty())
+            result += '@';
+        else if (variables.resolve(variable))
+            result += variable;
+        else
+            result += '@' + variable + '@';
+        pos = end + 1;
+    }
+    return result;
+}
+
+std::string describe(const Template& parts, const NameVariables& variables)
+{
+    return joinTemplate(
+        parts, [&](const std::string& part) { return expand(part, variables); });
+}
+
+} // namespace Core
+} // namespace GA
@@ -0,0 +1,89 @@
+/*
+ * File:   naming.h
+ */
+
+#ifndef __GA_CORE_NAMING_H__
+#define __GA_CORE_NAMING_H__
+
+#include <string>
+#include <vector>
+
+namespace GA {
+namespace Core {
+
+/*
+The parts of an eqnamer name template, e.g.
+    { "@epi_description@", "@dist@ km @dir@ of @poi@", "@poi_country@" }.
+Each part is expanded on its own; the non-empty results are joined with ", ".
+*/
+using Template = std::vector<std::string>;
+
+// Eight-point compass direction ("N", "NE", ... "NW") of an azimuth in
+// degrees, "?" outside [0, 360].
+std::string compassDirection(double azimuth);
+
+// Label of a Crust_Type region attribute: "Coastal", "Offshore" for Oceanic,
+// empty for all others.
+std::string crustLabel(const std::string& crustType);
+
+// Description of the epicentre: the crust label followed by the country,
+// which is left out if it is empty or the home country.
+std::string epicentreDescription(
+    const std::string& country, const std::string& homeCountry, const std::string& crustLabel);
+
+/*
+The variables of a name template relating the epicentre to a place:
+    dist             distance in km
+    dir              compass direction of the epicentre from the place
+    poi              name of the place
+    poi_country      country of the place
+    epi_description  see epicentreDescription()
+The strings are referenced, not copied.
+*/
+class NameVariables {
+public:
+    NameVariables(int distance, double azimuth, const std::string& place,
+        const std::string& placeCountry, const std::string& epicentre);
+
+    // Replaces the name of a variable by its value, false for other names.
+    bool resolve(std::string& variable) const;
+
+private:
+    int _distance;
+    std::string _direction;
+    const std::string& _place;
+    const std::string& _placeCountry;
+    const std::string& _epicentre;
+};
+
+/*
+Replaces the @variable@ references of text with their values. Unknown
+variables are kept as they are, "@@" stands for a literal "@". This is the
+syntax of Seiscomp::Util::replace.
+*/
+std::string expand(const std::string& text, const NameVariables& variables);
+
+// Expands the parts of a template with expandPart and joins the non-empty
+// results with ", ".
+template <typename Expand>
+std::string joinTemplate(const Template& parts, Expand expandPart)
+{
+    std::string result;
+    for (const std::string& part : parts) {
+        const std::string expanded = expandPart(part);
+        if (expanded.empty())
+            continue;
+        if (!result.empty())
+            result += ", ";
+        result += expanded;
+    }
+    return result;
+}
+
+// Expands a template with expand() and joins it.
+std::string describe(const Template& parts, const NameVariables& variables);
+
+} // namespace Core
+} // namespace GA
+
+#endif /* __GA_CORE_NAMING_H__ */
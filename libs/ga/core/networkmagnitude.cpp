@@ -0,0 +1,208 @@
+#include "networkmagnitude.h"
+
+#include <algorithm>
+
+namespace GA {
+namespace Core {
+
+NetworkMagnitude::NetworkMagnitude()
+    : _random(2463534242u)
+{
+}
+
+bool NetworkMagnitude::less(NodeID a, NodeID b) const
+{
+    const Node& x = _nodes[a];
+    const Node& y = _nodes[b];
+    return x.value < y.value || (x.value == y.value && x.seq < y.seq);
+}
+
+void NetworkMagnitude::update(NodeID n)
+{
+    Node& node = _nodes[n];
+    node.size = 1 + size(node.left) + size(node.right);
+    node.sum = sum(node.left) + node.value + sum(node.right);
+}
+
+void NetworkMagnitude::split(NodeID t, NodeID key, NodeID* l, NodeID* r)
+{
+    if (t == Nil) {
+        *l = *r = Nil;
+        return;
+    }
+
+    if (less(t, key)) {
+        split(_nodes[t].right, key, &_nodes[t].right, r);
+        *l = t;
+    } else {
+        split(_nodes[t].left, key, l, &_nodes[t].left);
+        *r = t;
+    }
+    update(t);
+}
+
+NetworkMagnitude::NodeID NetworkMagnitude::merge(NodeID l, NodeID r)
+{
+    if (l == Nil) return r;
+    if (r == Nil) return l;
+
+    if (_nodes[l].priority > _nodes[r].priority) {
+        _nodes[l].right = merge(_nodes[l].right, r);
+        update(l);
+        return l;
+    }
+
+    _nodes[r].left = merge(l, _nodes[r].left);
+    update(r);
+    return r;
+}
+
+NetworkMagnitude::NodeID NetworkMagnitude::insert(NodeID t, NodeID n)
+{
+    NodeID l, r;
+    split(t, n, &l, &r);
+    return merge(merge(l, n), r);
+}
+
+NetworkMagnitude::NodeID NetworkMagnitude::erase(NodeID t, NodeID n)
+{
+    if (t == n)
+        return merge(_nodes[t].left, _nodes[t].right);
+
+    if (less(n, t))
+        _nodes[t].left = erase(_nodes[t].left, n);
+    else
+        _nodes[t].right = erase(_nodes[t].right, n);
+    update(t);
+    return t;
+}
+
+void NetworkMagnitude::set(const std::string& station, double magnitude)
+{
+    auto it = _stations.find(station);
+    if (it != _stations.end())
+        _root = erase(_root, it->second);
+
+    NodeID n;
+    if (it != _stations.end())
+        n = it->second;
+    else if (!_free.empty()) {
+        n = _free.back();
+        _free.pop_back();
+    } else {
+        n = static_cast<NodeID>(_nodes.size());
+        _nodes.emplace_back();
+    }
+
+    // xorshift32
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+
+    _nodes[n] = Node{magnitude, _seq++, _random, Nil, Nil, 1, magnitude};
+    _stations[station] = n;
+    _root = insert(_root, n);
+}
+
+bool NetworkMagnitude::remove(const std::string& station)
+{
+    auto it = _stations.find(station);
+    if (it == _stations.end())
+        return false;
+
+    _root = erase(_root, it->second);
+    _free.push_back(it->second);
+    _stations.erase(it);
+    return true;
+}
+
+void NetworkMagnitude::clear()
+{
+    _nodes.clear();
+    _free.clear();
+    _stations.clear();
+    _root = Nil;
+}
+
+double NetworkMagnitude::select(size_t k) const
+{
+    NodeID t = _root;
+    for (;;) {
+        const size_t left = size(_nodes[t].left);
+        if (k < left)
+            t = _nodes[t].left;
+        else if (k == left)
+            return _nodes[t].value;
+        else {
+            k -= left + 1;
+            t = _nodes[t].right;
+        }
+    }
+}
+
+double NetworkMagnitude::rangeSum(NodeID t, size_t lo, size_t hi) const
+{
+    if (t == Nil || lo >= hi)
+        return 0;
+
+    const Node& node = _nodes[t];
+    if (lo == 0 && hi >= node.size)
+        return node.sum;
+
+    const size_t left = size(node.left);
+    double result = 0;
+    if (lo < left)
+        result += rangeSum(node.left, lo, std::min(hi, left));
+    if (lo <= left && left < hi)
+        result += node.value;
+    if (hi > left + 1)
+        result += rangeSum(node.right, lo > left + 1 ? lo - left - 1 : 0, hi - left - 1);
+    return result;
+}
+
+bool NetworkMagnitude::mean(double* value) const
+{
+    if (_root == Nil)
+        return false;
+
+    *value = sum(_root) / size(_root);
+    return true;
+}
+
+bool NetworkMagnitude::median(double* value) const
+{
+    const size_t n = size(_root);
+    if (n == 0)
+        return false;
+
+    *value = n % 2 ? select(n / 2) : 0.5 * (select(n / 2 - 1) + select(n / 2));
+    return true;
+}
+
+bool NetworkMagnitude::trimmedMean(double percent, double* value) const
+{
+    const size_t n = size(_root);
+    if (n == 0 || percent < 0 || percent > 100)
+        return false;
+
+    const double x = percent * 0.005 * n;
+    const size_t k = static_cast<size_t>(x);
+    if (2 * k >= n) {
+        // Everything trimmed, only possible for 100 % and an even count
+        return median(value);
+    }
+
+    const size_t last = n - k - 1;
+    if (k == last) {
+        *value = select(k);
+        return true;
+    }
+
+    const double w = k + 1 - x;
+    const double total = w * (select(k) + select(last)) + rangeSum(_root, k + 1, last);
+    *value = total / (2 * w + (last - k - 1));
+    return true;
+}
+
+} // namespace Core
+} // namespace GA
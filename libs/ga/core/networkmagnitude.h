@@ -0,0 +1,102 @@
+/*
+ * File:   networkmagnitude.h
+ */
+
+#ifndef __GA_CORE_NETWORKMAGNITUDE_H__
+#define __GA_CORE_NETWORKMAGNITUDE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace GA {
+namespace Core {
+
+/*
+Network magnitude of a changing set of station magnitudes.
+
+Station magnitudes are kept in an order statistic tree (a treap whose nodes
+carry the size and value sum of their subtree), so inserting, updating or
+removing a station and reading the mean, median or trimmed mean each take
+O(log N), instead of sorting all station magnitudes again for every arrival.
+
+The averages are defined as in SeisComP (Math::Statistics), so they match a
+batch computation over the same values; sums may differ from a sequential
+sum in the last bits, as they are added in tree order.
+
+mla-replay --magnitudes follows the network magnitude of every origin and
+type with it while the station magnitudes are added. scmag computes network
+magnitudes itself and offers no plugin hook for it.
+
+Not thread safe.
+*/
+class NetworkMagnitude {
+public:
+    NetworkMagnitude();
+
+    // Adds the magnitude of a station or replaces its previous one.
+    void set(const std::string& station, double magnitude);
+
+    // Removes a station, returns whether it was present.
+    bool remove(const std::string& station);
+
+    void clear();
+
+    size_t size() const { return _stations.size(); }
+
+    // All averages return false for an empty set.
+    bool mean(double* value) const;
+
+    // Mean of the two middle values for an even count.
+    bool median(double* value) const;
+
+    /*
+    Mean without the smallest and largest percent/2 % of the values. As in
+    Math::Statistics::trimmedMean, the values at the cut enter with the
+    fractional weight k + 1 - x, x = percent/200 * n, k = floor(x).
+    */
+    bool trimmedMean(double percent, double* value) const;
+
+private:
+    typedef uint32_t NodeID;
+    static const NodeID Nil = ~NodeID(0);
+
+    struct Node {
+        double value;
+        uint64_t seq;       // insertion order, orders equal values
+        uint32_t priority;
+        NodeID left, right;
+        size_t size;
+        double sum;
+    };
+
+    bool less(NodeID a, NodeID b) const;
+    void update(NodeID n);
+    // Splits t into the nodes ordered before node key and the rest.
+    void split(NodeID t, NodeID key, NodeID* l, NodeID* r);
+    NodeID merge(NodeID l, NodeID r);
+    NodeID insert(NodeID t, NodeID n);
+    NodeID erase(NodeID t, NodeID n);
+
+    // Value of rank k (0-based).
+    double select(size_t k) const;
+    // Sum of the values of ranks [lo, hi).
+    double rangeSum(NodeID t, size_t lo, size_t hi) const;
+
+    size_t size(NodeID n) const { return n == Nil ? 0 : _nodes[n].size; }
+    double sum(NodeID n) const { return n == Nil ? 0 : _nodes[n].sum; }
+
+    std::vector<Node> _nodes;
+    std::vector<NodeID> _free;
+    std::unordered_map<std::string, NodeID> _stations;
+    NodeID _root{Nil};
+    uint64_t _seq{0};
+    uint32_t _random;
+};
+
+} // namespace Core
+} // namespace GA
+
+#endif /* __GA_CORE_NETWORKMAGNITUDE_H__ */
@@ -0,0 +1,193 @@
+#include "pointindex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace GA {
+namespace Core {
+
+namespace {
+
+constexpr double DEG2RAD = M_PI / 180.0;
+
+// Chord length squared between two unit vectors separated by angle deg.
+double chord2(double deg)
+{
+    const double c = 2.0 * std::sin(std::min(deg, 180.0) * DEG2RAD / 2.0);
+    return c * c;
+}
+
+double chord2ToDeg(double c2)
+{
+    return 2.0 * std::asin(std::min(1.0, std::sqrt(c2) / 2.0)) / DEG2RAD;
+}
+
+} // namespace
+
+std::array<double, 3> PointIndex::unitVector(double lat, double lon)
+{
+    const double phi = lat * DEG2RAD;
+    const double lambda = lon * DEG2RAD;
+    const double c = std::cos(phi);
+    return { c * std::cos(lambda), c * std::sin(lambda), std::sin(phi) };
+}
+
+double PointIndex::dist2(const Vec& a, const Vec& b)
+{
+    const double dx = a[0] - b[0];
+    const double dy = a[1] - b[1];
+    const double dz = a[2] - b[2];
+    return dx * dx + dy * dy + dz * dz;
+}
+
+void PointIndex::add(double lat, double lon) { _points.push_back(unitVector(lat, lon)); }
+
+void PointIndex::reserve(size_t n) { _points.reserve(n); }
+
+void PointIndex::clear()
+{
+    _points.clear();
+    _tree.clear();
+    _order.clear();
+    _axis.clear();
+}
+
+void PointIndex::build()
+{
+    _order.resize(_points.size());
+    std::iota(_order.begin(), _order.end(), size_t(0));
+    _axis.assign(_points.size(), 0);
+    buildNode(0, _order.size());
+
+    _tree.resize(_order.size());
+    for (size_t i = 0; i < _order.size(); ++i)
+        _tree[i] = _points[_order[i]];
+}
+
+void PointIndex::buildNode(size_t lo, size_t hi)
+{
+    if (hi - lo < 2)
+        return;
+
+    // Split on the axis with the largest extent.
+    Vec minV = _points[_order[lo]], maxV = minV;
+    for (size_t i = lo + 1; i < hi; ++i) {
+        const Vec& p = _points[_order[i]];
+        for (int a = 0; a < 3; ++a) {
+            minV[a] = std::min(minV[a], p[a]);
+            maxV[a] = std::max(maxV[a], p[a]);
+        }
+    }
+    unsigned char axis = 0;
+    for (unsigned char a = 1; a < 3; ++a) {
+        if (maxV[a] - minV[a] > maxV[axis] - minV[axis])
+            axis = a;
+    }
+
+    const size_t mid = (lo + hi) / 2;
+    std::nth_element(_order.begin() + lo, _order.begin() + mid, _order.begin() + hi,
+        [&](size_t x, size_t y) { return _points[x][axis] < _points[y][axis]; });
+    _axis[mid] = axis;
+
+    buildNode(lo, mid);
+    buildNode(mid + 1, hi);
+}
+
+void PointIndex::searchNearest(
+    size_t lo, size_t hi, const Vec& q, size_t k, std::vector<Candidate>& heap) const
+{
+    if (lo >= hi)
+        return;
+
+    const size_t mid = (lo + hi) / 2;
+    const Candidate c { dist2(q, _tree[mid]), _order[mid] };
+
+    if (heap.size() < k) {
+        heap.push_back(c);
+        std::push_heap(heap.begin(), heap.end());
+    } else if (c < heap.front()) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = c;
+        std::push_heap(heap.begin(), heap.end());
+    }
+
+    if (hi - lo == 1)
+        return;
+
+    const double diff = q[_axis[mid]] - _tree[mid][_axis[mid]];
+    const bool leftFirst = diff < 0;
+
+    if (leftFirst)
+        searchNearest(lo, mid, q, k, heap);
+    else
+        searchNearest(mid + 1, hi, q, k, heap);
+
+    // The far side can only hold closer points (or equally close ones with a
+    // lower index) if the splitting plane is not further than the worst
+    // candidate.
+    if (heap.size() < k || diff * diff <= heap.front().dist2) {
+        if (leftFirst)
+            searchNearest(mid + 1, hi, q, k, heap);
+        else
+            searchNearest(lo, mid, q, k, heap);
+    }
+}
+
+void PointIndex::searchWithin(
+    size_t lo, size_t hi, const Vec& q, double radius2, std::vector<size_t>& out) const
+{
+    if (lo >= hi)
+        return;
+
+    const size_t mid = (lo + hi) / 2;
+    if (dist2(q, _tree[mid]) <= radius2)
+        out.push_back(_order[mid]);
+
+    if (hi - lo == 1)
+        return;
+
+    const double diff = q[_axis[mid]] - _tree[mid][_axis[mid]];
+    if (diff <= 0 || diff * diff <= radius2)
+        searchWithin(lo, mid, q, radius2, out);
+    if (diff >= 0 || diff * diff <= radius2)
+        searchWithin(mid + 1, hi, q, radius2, out);
+}
+
+size_t PointIndex::nearest(double lat, double lon) const
+{
+    const std::vector<size_t> result = nearest(lat, lon, 1);
+    return result.empty() ? npos : result.front();
+}
+
+std::vector<size_t> PointIndex::nearest(double lat, double lon, size_t k) const
+{
+    std::vector<size_t> result;
+    if (_tree.empty() || k == 0)
+        return result;
+
+    std::vector<Candidate> heap;
+    heap.reserve(k + 1);
+    searchNearest(0, _tree.size(), unitVector(lat, lon), k, heap);
+
+    std::sort_heap(heap.begin(), heap.end());
+    result.reserve(heap.size());
+    for (const Candidate& c : heap)
+        result.push_back(c.index);
+    return result;
+}
+
+void PointIndex::within(double lat, double lon, double radius, std::vector<size_t>& out) const
+{
+    if (_tree.empty() || radius < 0)
+        return;
+    searchWithin(0, _tree.size(), unitVector(lat, lon), chord2(radius), out);
+}
+
+double PointIndex::distance(size_t i, double lat, double lon) const
+{
+    return chord2ToDeg(dist2(_points[i], unitVector(lat, lon)));
+}
+
+} // namespace Core
+} // namespace GA
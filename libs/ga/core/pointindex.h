@@ -0,0 +1,95 @@
+/*
+ * File:   pointindex.h
+ */
+
+#ifndef __GA_CORE_POINTINDEX_H__
+#define __GA_CORE_POINTINDEX_H__
+
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace GA {
+namespace Core {
+
+/*
+Nearest-point index over a set of geographic points.
+
+Points are stored as unit vectors in a balanced k-d tree. The straight-line
+(chord) distance between unit vectors increases monotonically with the
+great-circle distance on the sphere, so nearest neighbours by chord are
+nearest neighbours on the sphere. Ties are broken by insertion index, which
+makes every query deterministic.
+
+Distances returned by the index are spherical great-circle distances in
+degrees. Callers that rank points with a different distance function (e.g.
+an ellipsoidal one) should use within() with a small safety margin around the
+nearest() result and re-rank the candidates themselves.
+*/
+class PointIndex {
+public:
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    // Adds a point. Its index is the number of points added before it. The
+    // index must be (re)built after adding points.
+    void add(double lat, double lon);
+    void reserve(size_t n);
+    void clear();
+
+    // Builds the tree over all points added so far.
+    void build();
+
+    size_t size() const { return _points.size(); }
+    bool empty() const { return _points.empty(); }
+
+    // Returns the index of the closest point, or npos if the index is empty.
+    size_t nearest(double lat, double lon) const;
+
+    // Returns the indices of the k closest points, closest first.
+    std::vector<size_t> nearest(double lat, double lon, size_t k) const;
+
+    // Appends the indices of all points within radius degrees to out, in no
+    // particular order.
+    void within(double lat, double lon, double radius, std::vector<size_t>& out) const;
+
+    // Great-circle distance in degrees between (lat, lon) and point i.
+    double distance(size_t i, double lat, double lon) const;
+
+    // Unit vector of a geographic position.
+    static std::array<double, 3> unitVector(double lat, double lon);
+
+private:
+    using Vec = std::array<double, 3>;
+
+    struct Candidate {
+        double dist2;
+        size_t index;
+        bool operator<(const Candidate& other) const
+        {
+            return dist2 < other.dist2 || (dist2 == other.dist2 && index < other.index);
+        }
+    };
+
+    void buildNode(size_t lo, size_t hi);
+    void searchNearest(size_t lo, size_t hi, const Vec& q, size_t k,
+        std::vector<Candidate>& heap) const;
+    void searchWithin(size_t lo, size_t hi, const Vec& q, double radius2,
+        std::vector<size_t>& out) const;
+
+    static double dist2(const Vec& a, const Vec& b);
+
+    // Points in insertion order.
+    std::vector<Vec> _points;
+
+    // Tree in implicit layout: the node of range [lo, hi) is stored at
+    // (lo + hi) / 2 and splits on _axis of that slot.
+    std::vector<Vec> _tree;
+    std::vector<size_t> _order;
+    std::vector<unsigned char> _axis;
+};
+
+} // namespace Core
+} // namespace GA
+
+#endif /* __GA_CORE_POINTINDEX_H__ */
@@ -0,0 +1,270 @@
+#include "rules.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace GA {
+namespace Core {
+
+namespace {
+
+struct KeyName {
+    const char* name;
+    double ConditionValues::*member;
+};
+
+const KeyName KEYS[] = {
+    { "mag", &ConditionValues::magnitude },
+    { "magnitude", &ConditionValues::magnitude },
+    { "stations", &ConditionValues::stations },
+    { "depth", &ConditionValues::depth },
+    { "lat", &ConditionValues::latitude },
+    { "latitude", &ConditionValues::latitude },
+    { "lon", &ConditionValues::longitude },
+    { "longitude", &ConditionValues::longitude },
+};
+
+} // namespace
+
+// Recursive descent parser, one function per precedence level.
+class Condition::Parser {
+public:
+    Parser(const std::string& text, std::vector<Node>& nodes)
+        : _text(text)
+        , _nodes(nodes)
+    {
+    }
+
+    uint32_t parse()
+    {
+        const uint32_t root = parseOr();
+        skipSpace();
+        if (_pos != _text.size())
+            fail("unexpected '" + _text.substr(_pos, 1) + "'");
+        return root;
+    }
+
+private:
+    uint32_t parseOr()
+    {
+        uint32_t left = parseAnd();
+        while (accept("||"))
+            left = add(Op::Or, left, parseAnd());
+        return left;
+    }
+
+    uint32_t parseAnd()
+    {
+        uint32_t left = parseComparison();
+        while (accept("&&"))
+            left = add(Op::And, left, parseComparison());
+        return left;
+    }
+
+    uint32_t parseComparison()
+    {
+        const uint32_t left = parseUnary();
+        Op op;
+        if (!acceptComparison(op))
+            return left;
+
+        const uint32_t comparison = add(op, left, parseUnary());
+        // "4 <= mag <= 6" would compare the 0 or 1 of the first comparison
+        if (acceptComparison(op))
+            fail("chained comparison, combine comparisons with &&");
+        return comparison;
+    }
+
+    bool acceptComparison(Op& op)
+    {
+        // Two character operators first
+        if (accept("<="))
+            op = Op::LessEqual;
+        else if (accept(">="))
+            op = Op::GreaterEqual;
+        else if (accept("=="))
+            op = Op::Equal;
+        else if (accept("!="))
+            op = Op::NotEqual;
+        else if (accept("<"))
+            op = Op::Less;
+        else if (accept(">"))
+            op = Op::Greater;
+        else
+            return false;
+        return true;
+    }
+
+    uint32_t parseUnary()
+    {
+        skipSpace();
+        if (accept("!"))
+            return add(Op::Not, parseUnary(), 0);
+        if (accept("-"))
+            return add(Op::Negate, parseUnary(), 0);
+        return parsePrimary();
+    }
+
+    uint32_t parsePrimary()
+    {
+        skipSpace();
+        if (_pos == _text.size())
+            fail("unexpected end");
+
+        if (accept("(")) {
+            const uint32_t inner = parseOr();
+            if (!accept(")"))
+                fail("missing ')'");
+            return inner;
+        }
+
+        const char c = _text[_pos];
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            const char* begin = _text.c_str() + _pos;
+            char* end = nullptr;
+            const double number = std::strtod(begin, &end);
+            if (end == begin)
+                fail("invalid number");
+            _pos += end - begin;
+            Node node {};
+            node.op = Op::Number;
+            node.number = number;
+            return push(node);
+        }
+
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            const size_t begin = _pos;
+            while (_pos < _text.size()
+                && (std::isalnum(static_cast<unsigned char>(_text[_pos])) || _text[_pos] == '_'))
+                ++_pos;
+            const std::string name = _text.substr(begin, _pos - begin);
+            for (size_t i = 0; i < sizeof(KEYS) / sizeof(KEYS[0]); ++i) {
+                if (name == KEYS[i].name) {
+                    Node node {};
+                    node.op = Op::Key;
+                    node.key = static_cast<uint8_t>(i);
+                    return push(node);
+                }
+            }
+            fail("unknown key '" + name + "'");
+        }
+
+        fail("unexpected '" + std::string(1, c) + "'");
+        return 0;
+    }
+
+    uint32_t add(Op op, uint32_t left, uint32_t right)
+    {
+        Node node {};
+        node.op = op;
+        node.left = left;
+        node.right = right;
+        return push(node);
+    }
+
+    uint32_t push(const Node& node)
+    {
+        _nodes.push_back(node);
+        return static_cast<uint32_t>(_nodes.size() - 1);
+    }
+
+    void skipSpace()
+    {
+        while (_pos < _text.size() && std::isspace(static_cast<unsigned char>(_text[_pos])))
+            ++_pos;
+    }
+
+    bool peek(const char* token)
+    {
+        skipSpace();
+        return _text.compare(_pos, std::char_traits<char>::length(token), token) == 0;
+    }
+
+    bool accept(const char* token)
+    {
+        if (!peek(token))
+            return false;
+        _pos += std::char_traits<char>::length(token);
+        return true;
+    }
+
+    [[noreturn]] void fail(const std::string& message) const
+    {
+        throw std::invalid_argument(message + " at position " + std::to_string(_pos));
+    }
+
+    const std::string& _text;
+    std::vector<Node>& _nodes;
+    size_t _pos { 0 };
+};
+
+Condition::Condition(const std::string& text)
+    : _text(text)
+{
+    Parser parser(_text, _nodes);
+    _root = parser.parse();
+}
+
+Condition::Outcome Condition::evaluate(const ConditionValues& values) const
+{
+    bool missing = false;
+    const double result = value(_root, values, missing);
+    if (missing)
+        return Outcome::Missing;
+    return result != 0 ? Outcome::True : Outcome::False;
+}
+
+double Condition::value(uint32_t index, const ConditionValues& values, bool& missing) const
+{
+    const Node& node = _nodes[index];
+    switch (node.op) {
+    case Op::Number:
+        return node.number;
+    case Op::Key: {
+        const double v = values.*KEYS[node.key].member;
+        if (std::isnan(v))
+            missing = true;
+        return missing ? 0 : v;
+    }
+    case Op::Not:
+        return value(node.left, values, missing) == 0;
+    case Op::Negate:
+        return -value(node.left, values, missing);
+    case Op::And:
+        return value(node.left, values, missing) != 0 && !missing
+            && value(node.right, values, missing) != 0;
+    case Op::Or:
+        return (value(node.left, values, missing) != 0 && !missing)
+            || (!missing && value(node.right, values, missing) != 0);
+    default:
+        break;
+    }
+
+    const double left = value(node.left, values, missing);
+    if (missing)
+        return 0;
+    const double right = value(node.right, values, missing);
+    if (missing)
+        return 0;
+
+    switch (node.op) {
+    case Op::Less:
+        return left < right;
+    case Op::LessEqual:
+        return left <= right;
+    case Op::Greater:
+        return left > right;
+    case Op::GreaterEqual:
+        return left >= right;
+    case Op::Equal:
+        return left == right;
+    case Op::NotEqual:
+        return left != right;
+    default:
+        return 0;
+    }
+}
+
+} // namespace Core
+} // namespace GA
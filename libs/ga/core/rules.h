@@ -0,0 +1,142 @@
+/*
+ * File:   rules.h
+ */
+
+#ifndef __GA_CORE_RULES_H__
+#define __GA_CORE_RULES_H__
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace GA {
+namespace Core {
+
+// Origin attributes a rule condition can refer to; NaN if not available.
+struct ConditionValues {
+    double magnitude { NAN }; // mag, magnitude: value of the reference magnitude
+    double stations { NAN };  // stations: its station count
+    double depth { NAN };     // depth in km
+    double latitude { NAN };  // lat, latitude
+    double longitude { NAN }; // lon, longitude
+};
+
+/*
+A magselect rule condition, e.g. "mag >= 4.0 && stations >= 3".
+
+Operands are the keys of ConditionValues and numbers. Operators, from the
+highest to the lowest precedence: unary ! and -, the comparisons < <= > >= ==
+!=, && and ||, with parentheses for grouping. A comparison is 1 if it holds,
+0 otherwise; in logical context every non-zero value is true. Comparisons do
+not chain: "4 <= mag <= 6" is a syntax error, write "mag >= 4 && mag <= 6".
+&& and || evaluate their right operand only if the left one does not decide.
+
+The text is parsed once into a flat expression tree; evaluation does not
+allocate.
+*/
+class Condition {
+public:
+    enum class Outcome {
+        False,
+        True,
+        // A key that was evaluated has no value
+        Missing
+    };
+
+    // Parses text, throws std::invalid_argument on syntax errors and unknown
+    // keys.
+    explicit Condition(const std::string& text);
+
+    Outcome evaluate(const ConditionValues& values) const;
+
+    const std::string& text() const { return _text; }
+
+private:
+    enum class Op : uint8_t {
+        Number,
+        Key,
+        Not,
+        Negate,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Equal,
+        NotEqual,
+        And,
+        Or
+    };
+
+    struct Node {
+        Op op;
+        // Key: offset of the value in ConditionValues
+        uint8_t key;
+        double number;
+        // Operands, as positions in _nodes
+        uint32_t left;
+        uint32_t right;
+    };
+
+    class Parser;
+
+    // Value of a node; sets missing and returns 0 if a key has no value.
+    double value(uint32_t node, const ConditionValues& values, bool& missing) const;
+
+    std::string _text;
+    std::vector<Node> _nodes;
+    uint32_t _root { 0 };
+};
+
+/*
+Per rule counters.
+    evaluated    condition was evaluated
+    matched      condition held
+    typeMissing  condition held but the magnitude type was not available
+    valueMissing the condition needed a value that was not available
+*/
+struct RuleStats {
+    uint64_t evaluated { 0 };
+    uint64_t matched { 0 };
+    uint64_t typeMissing { 0 };
+    uint64_t valueMissing { 0 };
+};
+
+struct Rule {
+    std::string name;
+    Condition condition;
+    std::string magnitudeType;
+    RuleStats stats;
+};
+
+/*
+Walks the rules in order and returns the first one whose condition holds and
+whose magnitude type is available, or nullptr. available(type) is only called
+for rules whose condition holds. Updates the counters of the rules.
+*/
+template <typename Available>
+const Rule* selectRule(std::vector<Rule>& rules, const ConditionValues& values, Available available)
+{
+    for (Rule& rule : rules) {
+        ++rule.stats.evaluated;
+
+        const Condition::Outcome outcome = rule.condition.evaluate(values);
+        if (outcome == Condition::Outcome::Missing) {
+            ++rule.stats.valueMissing;
+            continue;
+        }
+        if (outcome == Condition::Outcome::False)
+            continue;
+
+        ++rule.stats.matched;
+        if (available(rule.magnitudeType))
+            return &rule;
+        ++rule.stats.typeMissing;
+    }
+    return nullptr;
+}
+
+} // namespace Core
+} // namespace GA
+
+#endif /* __GA_CORE_RULES_H__ */
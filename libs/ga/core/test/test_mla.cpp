@@ -0,0 +1,60 @@
+#include <ga/core/mla.h>
+#include <ga/test/check.h>
+
+#include <cmath>
+
+using GA::Core::MLa::Region;
+
+namespace {
+
+void testRegions()
+{
+    Region region = Region::East;
+    GA_CHECK(GA::Core::MLa::regionByName("West", region) && region == Region::West);
+    GA_CHECK(GA::Core::MLa::regionByName("South", region) && region == Region::South);
+    GA_CHECK(GA::Core::MLa::regionByName("East", region) && region == Region::East);
+    GA_CHECK(!GA::Core::MLa::regionByName("east", region) && region == Region::East);
+}
+
+void testCorrections()
+{
+    GA_CHECK_CLOSE(GA::Core::MLa::hypocentralDistance(30, 40), 50.0, 1e-12);
+    GA_CHECK_CLOSE(GA::Core::MLa::hypocentralDistance(25, 0), 25.0, 1e-12);
+
+    // The published formulas at R = 100 km and R = 10 km
+    GA_CHECK_CLOSE(GA::Core::MLa::correctionWest(100), 2.274 + 0.0657 + 0.66, 1e-12);
+    GA_CHECK_CLOSE(GA::Core::MLa::correctionEast(100), 3.13, 1e-12);
+    GA_CHECK_CLOSE(GA::Core::MLa::correctionSouth(100), 2.2 + 0.13 + 0.7, 1e-12);
+    GA_CHECK_CLOSE(GA::Core::MLa::correctionWest(10), 1.137 + 0.00657 + 0.66, 1e-12);
+    GA_CHECK_CLOSE(GA::Core::MLa::correctionEast(10), -1.34 - 0.0495 + 3.13, 1e-12);
+    GA_CHECK_CLOSE(GA::Core::MLa::correctionSouth(10), 1.1 + 0.013 + 0.7, 1e-12);
+
+    for (double r : { 5.0, 50.0, 300.0, 1500.0 }) {
+        GA_CHECK(GA::Core::MLa::correction(Region::West, r) == GA::Core::MLa::correctionWest(r));
+        GA_CHECK(GA::Core::MLa::correction(Region::East, r) == GA::Core::MLa::correctionEast(r));
+        GA_CHECK(GA::Core::MLa::correction(Region::South, r) == GA::Core::MLa::correctionSouth(r));
+        GA_CHECK(GA::Core::MLa::smallestCorrection(r)
+            == std::fmin(GA::Core::MLa::correctionWest(r),
+                std::fmin(GA::Core::MLa::correctionEast(r), GA::Core::MLa::correctionSouth(r))));
+    }
+}
+
+void testMagnitude()
+{
+    // 1 mm at 100 km is the East reference level, 10 mm one unit more
+    GA_CHECK_CLOSE(GA::Core::MLa::magnitude(Region::East, 1.0, 100), 3.13, 1e-12);
+    GA_CHECK_CLOSE(GA::Core::MLa::magnitude(Region::East, 10.0, 100), 4.13, 1e-12);
+    GA_CHECK_CLOSE(GA::Core::MLa::magnitude(Region::West, 0.01, 100), 2.9997 - 2, 1e-12);
+    GA_CHECK_CLOSE(GA::Core::MLa::magnitude(Region::South, 0.5, 10),
+        std::log10(0.5) + GA::Core::MLa::correctionSouth(10), 1e-12);
+}
+
+} // namespace
+
+int main()
+{
+    testRegions();
+    testCorrections();
+    testMagnitude();
+    return GA::Test::result();
+}
@@ -0,0 +1,65 @@
+#include <ga/core/naming.h>
+#include <ga/test/check.h>
+
+#include <string>
+
+using GA::Core::NameVariables;
+
+namespace {
+
+void testCompassDirection()
+{
+    struct {
+        double azimuth;
+        const char* direction;
+    } const cases[] {
+        { 0, "N" }, { 22.4, "N" }, { 22.5, "NE" }, { 67.5, "NE" }, { 67.6, "E" }, { 112.5, "SE" },
+        { 157.6, "S" }, { 202.5, "SW" }, { 247.6, "W" }, { 292.5, "NW" }, { 337.5, "NW" },
+        { 337.6, "N" }, { 360, "N" },
+    };
+    for (const auto& c : cases)
+        GA_CHECK(GA::Core::compassDirection(c.azimuth) == c.direction);
+}
+
+void testDescription()
+{
+    GA_CHECK(GA::Core::crustLabel("Oceanic") == "Offshore");
+    GA_CHECK(GA::Core::crustLabel("Coastal") == "Coastal");
+    GA_CHECK(GA::Core::crustLabel("Continental").empty());
+
+    GA_CHECK(GA::Core::epicentreDescription("Australia", "Australia", "Offshore") == "Offshore");
+    GA_CHECK(GA::Core::epicentreDescription("", "Australia", "") == "");
+    GA_CHECK(GA::Core::epicentreDescription("Indonesia", "Australia", "") == "Indonesia");
+    GA_CHECK(GA::Core::epicentreDescription("Indonesia", "Australia", "Offshore") == "Offshore Indonesia");
+}
+
+void testExpand()
+{
+    const std::string place = "Canberra", country = "Australia", epicentre = "Coastal";
+    const NameVariables variables(12, 95, place, country, epicentre);
+
+    GA_CHECK(GA::Core::expand("@dist@ km @dir@ of @poi@", variables) == "12 km E of Canberra");
+    GA_CHECK(GA::Core::expand("@epi_description@, @poi_country@", variables) == "Coastal, Australia");
+
+    // Unknown variables are kept, @@ is a literal @, an unmatched @ is text
+    GA_CHECK(GA::Core::expand("@region@ @poi@", variables) == "@region@ Canberra");
+    GA_CHECK(GA::Core::expand("a@@b", variables) == "a@b");
+    GA_CHECK(GA::Core::expand("near @poi", variables) == "near @poi");
+    GA_CHECK(GA::Core::expand("", variables).empty());
+
+    // Empty parts are left out of the joined name
+    const std::string inland;
+    const NameVariables home(5, 210, place, country, inland);
+    GA_CHECK(GA::Core::describe({ "@epi_description@", "@dist@ km @dir@ of @poi@", "@poi_country@" }, home)
+        == "5 km SW of Canberra, Australia");
+}
+
+} // namespace
+
+int main()
+{
+    testCompassDirection();
+    testDescription();
+    testExpand();
+    return GA::Test::result();
+}
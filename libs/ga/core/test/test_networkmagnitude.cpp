@@ -0,0 +1,156 @@
+#include <ga/core/networkmagnitude.h>
+#include <ga/test/check.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using GA::Core::NetworkMagnitude;
+
+namespace {
+
+// Batch averages over sorted values, as defined in Math::Statistics
+double batchMean(const std::vector<double> &v)
+{
+    double sum = 0;
+    for (double x : v)
+        sum += x;
+    return sum / v.size();
+}
+
+double batchMedian(const std::vector<double> &v)
+{
+    const size_t n = v.size();
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+double batchTrimmedMean(const std::vector<double> &v, double percent)
+{
+    const size_t n = v.size();
+    const double x = percent * 0.005 * n;
+    const size_t k = static_cast<size_t>(x);
+    if (2 * k >= n)
+        return batchMedian(v);
+
+    double sum = 0, weights = 0;
+    for (size_t i = 0; i < n; ++i) {
+        double w = 1;
+        if (i < k || i >= n - k)
+            w = 0;
+        else if (i == k || i == n - k - 1)
+            w = k + 1 - x;
+        sum += w * v[i];
+        weights += w;
+    }
+    return sum / weights;
+}
+
+std::vector<double> sorted(const std::map<std::string, double> &stations)
+{
+    std::vector<double> values;
+    for (const auto& s : stations)
+        values.push_back(s.second);
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+void testEmpty()
+{
+    NetworkMagnitude network;
+    double value = 0;
+    GA_CHECK(!network.mean(&value));
+    GA_CHECK(!network.median(&value));
+    GA_CHECK(!network.trimmedMean(25, &value));
+    GA_CHECK(!network.remove("AU.ARMA"));
+}
+
+void testSmall()
+{
+    NetworkMagnitude network;
+    network.set("AU.A", 3.0);
+    network.set("AU.B", 1.0);
+    network.set("AU.C", 2.0);
+    network.set("AU.D", 10.0);
+
+    double value = 0;
+    GA_CHECK(network.median(&value) && value == 2.5);
+    GA_CHECK(network.mean(&value) && value == 4.0);
+
+    // Replacing a station does not add one
+    network.set("AU.D", 4.0);
+    GA_CHECK(network.size() == 4);
+    GA_CHECK(network.mean(&value) && value == 2.5);
+
+    GA_CHECK(network.remove("AU.B"));
+    GA_CHECK(!network.remove("AU.B"));
+    GA_CHECK(network.median(&value) && value == 3.0);
+
+    network.clear();
+    GA_CHECK(network.size() == 0 && !network.mean(&value));
+}
+
+// Random inserts, updates and removals against the batch computation over
+// the same station magnitudes, with many equal values.
+void testRandomized()
+{
+    std::mt19937 random(4711);
+    std::uniform_int_distribution<int> station(0, 299), action(0, 9), tenths(0, 60);
+    std::uniform_real_distribution<double> magnitude(0.0, 6.0);
+
+    NetworkMagnitude network;
+    std::map<std::string, double> stations;
+    const double percents[] { 0, 12.5, 25, 50, 100 };
+
+    double largest = 0;
+    bool sameSize = true, sameAvailability = true;
+    for (int step = 0; step < 200000; ++step) {
+        const std::string name = "AU.S" + std::to_string(station(random));
+        const int a = action(random);
+        if (a < 2) {
+            const bool present = stations.erase(name) > 0;
+            sameAvailability = sameAvailability && network.remove(name) == present;
+        } else {
+            const double value = a < 5 ? tenths(random) / 10.0 : magnitude(random);
+            stations[name] = value;
+            network.set(name, value);
+        }
+
+        sameSize = sameSize && network.size() == stations.size();
+        if (step % 7 != 0)
+            continue;
+
+        const std::vector<double> values = sorted(stations);
+        double value = 0;
+        if (values.empty()) {
+            sameAvailability = sameAvailability && !network.mean(&value) && !network.median(&value);
+            continue;
+        }
+
+        sameAvailability = sameAvailability && network.mean(&value);
+        largest = std::max(largest, std::fabs(value - batchMean(values)));
+        sameAvailability = sameAvailability && network.median(&value);
+        largest = std::max(largest, std::fabs(value - batchMedian(values)));
+        for (double percent : percents) {
+            sameAvailability = sameAvailability && network.trimmedMean(percent, &value);
+            largest = std::max(largest, std::fabs(value - batchTrimmedMean(values, percent)));
+        }
+    }
+
+    GA_CHECK(sameSize);
+    GA_CHECK(sameAvailability);
+    // Only the order of summation differs
+    GA_CHECK(largest <= 1e-12);
+}
+
+} // namespace
+
+int main()
+{
+    testEmpty();
+    testSmall();
+    testRandomized();
+    return GA::Test::result();
+}
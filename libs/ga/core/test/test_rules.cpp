@@ -0,0 +1,126 @@
+#include <ga/core/rules.h>
+#include <ga/test/check.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using GA::Core::Condition;
+using GA::Core::ConditionValues;
+using GA::Core::Rule;
+using Outcome = GA::Core::Condition::Outcome;
+
+namespace {
+
+ConditionValues origin(double magnitude, double stations)
+{
+    ConditionValues values;
+    values.magnitude = magnitude;
+    values.stations = stations;
+    values.depth = 10;
+    values.latitude = -35.3;
+    values.longitude = 149.1;
+    return values;
+}
+
+Outcome evaluate(const std::string& text, const ConditionValues& values)
+{
+    return Condition(text).evaluate(values);
+}
+
+void testOperators()
+{
+    const ConditionValues values = origin(4.2, 5);
+
+    GA_CHECK(evaluate("mag >= 4.0 && stations >= 3", values) == Outcome::True);
+    GA_CHECK(evaluate("magnitude < 4", values) == Outcome::False);
+    GA_CHECK(evaluate("mag > 5 || stations == 5", values) == Outcome::True);
+    GA_CHECK(evaluate("!(stations != 5)", values) == Outcome::True);
+    GA_CHECK(evaluate("lat < -30 && lon > 140", values) == Outcome::True);
+    GA_CHECK(evaluate("latitude == -35.3 && longitude <= 149.1", values) == Outcome::True);
+    GA_CHECK(evaluate("depth > 5 && depth < .5e2", values) == Outcome::True);
+
+    // && binds stronger than ||
+    GA_CHECK(evaluate("mag > 5 && stations > 3 || depth == 10", values) == Outcome::True);
+    GA_CHECK(evaluate("mag > 5 && (stations > 3 || depth == 10)", values) == Outcome::False);
+
+    // Values in logical context, comparisons as 0 or 1
+    GA_CHECK(evaluate("stations", values) == Outcome::True);
+    GA_CHECK(evaluate("0", values) == Outcome::False);
+    GA_CHECK(evaluate("(mag > 4) == 1", values) == Outcome::True);
+}
+
+void testMissing()
+{
+    ConditionValues values = origin(4.2, 5);
+    values.magnitude = NAN;
+
+    GA_CHECK(evaluate("mag >= 4", values) == Outcome::Missing);
+    GA_CHECK(evaluate("stations >= 3 && mag >= 4", values) == Outcome::Missing);
+
+    // The right operand is not evaluated if the left one decides
+    GA_CHECK(evaluate("stations < 3 && mag >= 4", values) == Outcome::False);
+    GA_CHECK(evaluate("stations >= 3 || mag >= 4", values) == Outcome::True);
+}
+
+void testSyntaxErrors()
+{
+    const char* const invalid[] {
+        "", "mag >=", "(mag > 4", "mag > 4)", "mag => 4", "magn > 4", "mag > 4 &&", "mag & stations",
+        // Comparisons do not chain
+        "4 <= mag <= 6", "mag > 4 == 1", "1 < 2 < 3",
+    };
+    for (const char* text : invalid)
+        GA_CHECK_THROWS(Condition { text }, std::invalid_argument);
+
+    Condition condition("mag >= 4 && mag <= 6");
+    GA_CHECK(condition.text() == "mag >= 4 && mag <= 6");
+    GA_CHECK(condition.evaluate(origin(5, 1)) == Outcome::True);
+    GA_CHECK(condition.evaluate(origin(6.5, 1)) == Outcome::False);
+}
+
+void testSelectRule()
+{
+    std::vector<Rule> rules {
+        { "large", Condition("mag >= 6.0 && stations >= 3"), "MLa01", {} },
+        { "medium", Condition("mag >= 4.0 && stations >= 3"), "MLa05", {} },
+        { "small", Condition("mag < 4.0 && stations >= 3"), "MLa075", {} },
+        { "fallback", Condition("stations >= 3"), "MLa075", {} },
+    };
+    std::vector<std::string> queried;
+    auto available = [&](const std::string& type) {
+        queried.push_back(type);
+        return type != "MLa05";
+    };
+
+    const Rule* rule = GA::Core::selectRule(rules, origin(6.3, 4), available);
+    GA_CHECK(rule == &rules[0]);
+    GA_CHECK(queried == std::vector<std::string> { "MLa01" });
+
+    // The medium rule matches but its type is missing, the next one wins
+    queried.clear();
+    rule = GA::Core::selectRule(rules, origin(4.5, 4), available);
+    GA_CHECK(rule == &rules[3]);
+    GA_CHECK((queried == std::vector<std::string> { "MLa05", "MLa075" }));
+
+    ConditionValues noMagnitude = origin(NAN, 2);
+    GA_CHECK(GA::Core::selectRule(rules, noMagnitude, available) == nullptr);
+
+    GA_CHECK(rules[0].stats.evaluated == 3 && rules[0].stats.matched == 1);
+    GA_CHECK(rules[0].stats.valueMissing == 1);
+    GA_CHECK(rules[1].stats.evaluated == 2 && rules[1].stats.matched == 1);
+    GA_CHECK(rules[1].stats.typeMissing == 1 && rules[1].stats.valueMissing == 1);
+    GA_CHECK(rules[2].stats.evaluated == 2 && rules[2].stats.matched == 0);
+    GA_CHECK(rules[3].stats.evaluated == 2 && rules[3].stats.matched == 1);
+}
+
+} // namespace
+
+int main()
+{
+    testOperators();
+    testMissing();
+    testSyntaxErrors();
+    testSelectRule();
+    return GA::Test::result();
+}
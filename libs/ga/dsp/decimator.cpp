@@ -0,0 +1,67 @@
+#include "decimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace GA {
+namespace DSP {
+
+Decimator::Decimator(size_t factor)
+    : _factor(std::max(factor, size_t(1)))
+{
+    // Transition band from 0.6 to 1.4 times the output Nyquist frequency:
+    // aliases of the stop band land above the passband. Hamming windows need
+    // about 3.3 / width taps for a transition width given relative to the
+    // input sampling rate.
+    const double nyquist = 0.5 / _factor;
+    const double width = 0.8 * nyquist;
+    size_t n = static_cast<size_t>(std::ceil(3.3 / width));
+    n |= 1;
+
+    _taps.resize(n);
+    const double center = 0.5 * (n - 1);
+    double sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const double t = i - center;
+        const double sinc = t == 0 ? 2 * nyquist : std::sin(2 * M_PI * nyquist * t) / (M_PI * t);
+        const double window = n > 1 ? 0.54 - 0.46 * std::cos(2 * M_PI * i / (n - 1)) : 1.0;
+        _taps[i] = sinc * window;
+        sum += _taps[i];
+    }
+    // Unit gain at DC
+    for (double& tap : _taps)
+        tap /= sum;
+
+    reset();
+}
+
+void Decimator::reset()
+{
+    _buffer.assign(_taps.size() - 1, 0.0);
+    _phase = 0;
+}
+
+size_t Decimator::apply(const double* in, size_t n, std::vector<double>& out)
+{
+    const size_t history = _taps.size() - 1;
+    _buffer.insert(_buffer.end(), in, in + n);
+
+    // Input sample i of this block is _buffer[history + i], its output needs
+    // _buffer[i .. i + history].
+    const size_t first = _phase;
+    size_t i = _phase;
+    for (; i < n; i += _factor) {
+        const double* x = &_buffer[i];
+        double y = 0;
+        for (size_t k = 0; k < _taps.size(); ++k)
+            y += _taps[k] * x[history - k];
+        out.push_back(y);
+    }
+    _phase = i - n;
+
+    _buffer.erase(_buffer.begin(), _buffer.end() - history);
+    return first < n ? first : n;
+}
+
+} // namespace DSP
+} // namespace GA
@@ -0,0 +1,58 @@
+/*
+ * File:   decimator.h
+ */
+
+#ifndef __GA_DSP_DECIMATOR_H__
+#define __GA_DSP_DECIMATOR_H__
+
+#include <cstddef>
+#include <vector>
+
+namespace GA {
+namespace DSP {
+
+/*
+Anti-aliased decimation by an integer factor.
+
+The lowpass is a linear phase FIR (Hamming windowed sinc) with its cutoff at
+the output Nyquist frequency and the passband up to 0.6 times it, long
+enough that aliases stay below about -50 dB in the passband. Only every
+factor-th output is computed, which is what the polyphase form of the filter
+amounts to: the cost is taps / factor multiplications per input sample.
+
+Like the IIR filters, it starts with zero history. Its output is delayed by
+delay() input samples.
+*/
+class Decimator {
+public:
+    explicit Decimator(size_t factor);
+
+    size_t factor() const { return _factor; }
+    size_t taps() const { return _taps.size(); }
+
+    // Group delay of the output in input samples.
+    double delay() const { return 0.5 * (_taps.size() - 1); }
+
+    // Forgets the history, e.g. after a gap.
+    void reset();
+
+    /*
+    Filters n input samples and appends every factor-th output to out.
+    Returns the index of the input sample the first appended output belongs
+    to (before the delay), or n if the block completed no output.
+    */
+    size_t apply(const double* in, size_t n, std::vector<double>& out);
+
+private:
+    size_t _factor;
+    std::vector<double> _taps;
+    // The last taps - 1 inputs followed by the current block
+    std::vector<double> _buffer;
+    // Inputs until the next output
+    size_t _phase { 0 };
+};
+
+} // namespace DSP
+} // namespace GA
+
+#endif /* __GA_DSP_DECIMATOR_H__ */
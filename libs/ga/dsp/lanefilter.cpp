@@ -0,0 +1,214 @@
+#include "lanefilter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+
+namespace GA {
+namespace DSP {
+
+std::vector<Biquad> butterworthHighpass(int order, double fc, double fsamp)
+{
+    std::vector<Biquad> sections;
+    if (order < 1 || fc <= 0 || fsamp <= 0 || fc >= fsamp / 2)
+        return sections;
+
+    // With p = s / wc and the bilinear transform s = 2 fs (1 - z^-1) / (1 + z^-1)
+    // prewarped at fc, p = (1 - z^-1) / (K (1 + z^-1)), K = tan(pi fc / fs).
+    const double K = std::tan(M_PI * fc / fsamp);
+
+    for (int k = 0; k < order / 2; ++k) {
+        // p^2 / (p^2 + d p + 1), d = 2 sin(theta) of the prototype pole pair
+        const double d = 2.0 * std::sin(M_PI * (2 * k + 1) / (2.0 * order));
+        const double a0 = 1.0 + d * K + K * K;
+        sections.push_back({ 1.0 / a0, -2.0 / a0, 1.0 / a0, (2.0 * K * K - 2.0) / a0,
+            (1.0 - d * K + K * K) / a0 });
+    }
+
+    if (order % 2) {
+        // p / (p + 1)
+        const double a0 = 1.0 + K;
+        sections.push_back({ 1.0 / a0, -1.0 / a0, 0.0, (K - 1.0) / a0, 0.0 });
+    }
+
+    return sections;
+}
+
+Biquad woodAndersonVelocity(double fsamp, double gain, double T0, double h)
+{
+    const double c = 2.0 * fsamp;
+    const double w0 = 2.0 * M_PI / T0;
+    const double a0 = c * c + 2.0 * h * w0 * c + w0 * w0;
+    return { gain * c / a0, 0.0, -gain * c / a0, (2.0 * w0 * w0 - 2.0 * c * c) / a0,
+        (c * c - 2.0 * h * w0 * c + w0 * w0) / a0 };
+}
+
+bool designMLaChain(const std::string& preFilter, double fsamp, double gain, double T0,
+    double h, std::vector<Biquad>& sections)
+{
+    sections.clear();
+
+    std::string spec;
+    for (char c : preFilter) {
+        if (!std::isspace(static_cast<unsigned char>(c)))
+            spec += c;
+    }
+
+    if (!spec.empty()) {
+        // The whole spec must be one BW_HP, not the start of a chain
+        int order;
+        double fc;
+        int length = 0;
+        if (std::sscanf(spec.c_str(), "BW_HP(%d,%lf)%n", &order, &fc, &length) != 2
+            || length != static_cast<int>(spec.size()))
+            return false;
+        sections = butterworthHighpass(order, fc, fsamp);
+        if (sections.empty())
+            return false;
+    }
+
+    sections.push_back(woodAndersonVelocity(fsamp, gain, T0, h));
+    return true;
+}
+
+LaneFilter::LaneFilter(const std::vector<Biquad>& sections)
+    : _sections(sections)
+{
+}
+
+void LaneFilter::grow(size_t lanes)
+{
+    if (lanes <= _capacity)
+        return;
+
+    const size_t capacity = std::max(lanes, _capacity * 2);
+    std::vector<double> z1(_sections.size() * capacity, 0.0);
+    std::vector<double> z2(_sections.size() * capacity, 0.0);
+    for (size_t s = 0; s < _sections.size(); ++s) {
+        std::copy_n(&_z1[s * _capacity], _lanes, &z1[s * capacity]);
+        std::copy_n(&_z2[s * _capacity], _lanes, &z2[s * capacity]);
+    }
+    _z1.swap(z1);
+    _z2.swap(z2);
+    _capacity = capacity;
+}
+
+size_t LaneFilter::addLane()
+{
+    grow(_lanes + 1);
+    reset(_lanes);
+    return _lanes++;
+}
+
+void LaneFilter::reset(size_t lane)
+{
+    for (size_t s = 0; s < _sections.size(); ++s) {
+        _z1[s * _capacity + lane] = 0.0;
+        _z2[s * _capacity + lane] = 0.0;
+    }
+}
+
+std::vector<double> LaneFilter::save(size_t lane) const
+{
+    std::vector<double> state;
+    state.reserve(_sections.size() * 2);
+    for (size_t s = 0; s < _sections.size(); ++s) {
+        state.push_back(_z1[s * _capacity + lane]);
+        state.push_back(_z2[s * _capacity + lane]);
+    }
+    return state;
+}
+
+void LaneFilter::restore(size_t lane, const std::vector<double>& state)
+{
+    for (size_t s = 0; s < _sections.size() && 2 * s + 1 < state.size(); ++s) {
+        _z1[s * _capacity + lane] = state[2 * s];
+        _z2[s * _capacity + lane] = state[2 * s + 1];
+    }
+}
+
+void LaneFilter::apply(size_t lane, double* data, size_t n)
+{
+    for (size_t s = 0; s < _sections.size(); ++s) {
+        const Biquad& q = _sections[s];
+        double z1 = _z1[s * _capacity + lane];
+        double z2 = _z2[s * _capacity + lane];
+        for (size_t t = 0; t < n; ++t) {
+            // Transposed direct form II
+            const double x = data[t];
+            const double y = q.b0 * x + z1;
+            z1 = q.b1 * x - q.a1 * y + z2;
+            z2 = q.b2 * x - q.a2 * y;
+            data[t] = y;
+        }
+        _z1[s * _capacity + lane] = z1;
+        _z2[s * _capacity + lane] = z2;
+    }
+}
+
+void LaneFilter::apply(size_t count, const size_t* lanes, double* const* data, const size_t* n)
+{
+    if (count == 0)
+        return;
+    if (count == 1) {
+        apply(lanes[0], data[0], n[0]);
+        return;
+    }
+
+    const size_t common = *std::min_element(n, n + count);
+    const size_t sections = _sections.size();
+
+    // Gather the state of the participating lanes so that the inner loop runs
+    // over contiguous memory, then interleave the common samples.
+    std::vector<double> z1(sections * count), z2(sections * count);
+    for (size_t s = 0; s < sections; ++s) {
+        for (size_t l = 0; l < count; ++l) {
+            z1[s * count + l] = _z1[s * _capacity + lanes[l]];
+            z2[s * count + l] = _z2[s * _capacity + lanes[l]];
+        }
+    }
+
+    _x.resize(common * count);
+    for (size_t t = 0; t < common; ++t) {
+        for (size_t l = 0; l < count; ++l)
+            _x[t * count + l] = data[l][t];
+    }
+
+    for (size_t t = 0; t < common; ++t) {
+        double* x = &_x[t * count];
+        for (size_t s = 0; s < sections; ++s) {
+            const Biquad q = _sections[s];
+            double* __restrict s1 = &z1[s * count];
+            double* __restrict s2 = &z2[s * count];
+            for (size_t l = 0; l < count; ++l) {
+                const double in = x[l];
+                const double y = q.b0 * in + s1[l];
+                s1[l] = q.b1 * in - q.a1 * y + s2[l];
+                s2[l] = q.b2 * in - q.a2 * y;
+                x[l] = y;
+            }
+        }
+    }
+
+    for (size_t t = 0; t < common; ++t) {
+        for (size_t l = 0; l < count; ++l)
+            data[l][t] = _x[t * count + l];
+    }
+
+    for (size_t s = 0; s < sections; ++s) {
+        for (size_t l = 0; l < count; ++l) {
+            _z1[s * _capacity + lanes[l]] = z1[s * count + l];
+            _z2[s * _capacity + lanes[l]] = z2[s * count + l];
+        }
+    }
+
+    // Remainders of the longer lanes
+    for (size_t l = 0; l < count; ++l) {
+        if (n[l] > common)
+            apply(lanes[l], data[l] + common, n[l] - common);
+    }
+}
+
+} // namespace DSP
+} // namespace GA
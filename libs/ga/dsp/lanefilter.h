@@ -0,0 +1,93 @@
+/*
+ * File:   lanefilter.h
+ */
+
+#ifndef __GA_DSP_LANEFILTER_H__
+#define __GA_DSP_LANEFILTER_H__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace GA {
+namespace DSP {
+
+// Second order section, normalised to a0 = 1.
+struct Biquad {
+    double b0, b1, b2;
+    double a1, a2;
+};
+
+/*
+Butterworth highpass of the given order and corner frequency as a cascade of
+second order sections (plus one first order section, b2 = a2 = 0, for odd
+orders), designed with the prewarped bilinear transform.
+*/
+std::vector<Biquad> butterworthHighpass(int order, double fc, double fsamp);
+
+/*
+Wood-Anderson simulation for velocity input,
+    H(s) = gain * s / (s^2 + 2 h w0 s + w0^2),  w0 = 2 pi / T0,
+designed with the bilinear transform.
+*/
+Biquad woodAndersonVelocity(double fsamp, double gain, double T0, double h);
+
+/*
+The MLa filter chain: the prefilter, which must be empty or BW_HP(order, fc),
+followed by the Wood-Anderson simulation. Returns false if the prefilter is
+not supported.
+*/
+bool designMLaChain(const std::string& preFilter, double fsamp, double gain, double T0,
+    double h, std::vector<Biquad>& sections);
+
+/*
+One cascade of second order sections applied to many independent channels
+(lanes) at once.
+
+The state of all lanes is stored section by section in contiguous arrays, so
+that apply() steps all lanes through a section with one loop over the lanes,
+which compilers vectorise. Lanes can be fed different amounts of samples in
+one call: the common length is processed in lockstep, the remainders lane by
+lane. Every lane starts with zero state, like a freshly built filter.
+*/
+class LaneFilter {
+public:
+    explicit LaneFilter(const std::vector<Biquad>& sections);
+
+    // Adds a lane with zero state and returns its ID.
+    size_t addLane();
+    size_t lanes() const { return _lanes; }
+
+    void reset(size_t lane);
+
+    // State of one lane, to undo the filtering of samples that were dropped
+    // afterwards.
+    std::vector<double> save(size_t lane) const;
+    void restore(size_t lane, const std::vector<double>& state);
+
+    /*
+    Filters the samples of count lanes in place. data[i] holds n[i] samples
+    of lane lanes[i]. A lane must not appear twice in one call.
+    */
+    void apply(size_t count, const size_t* lanes, double* const* data, const size_t* n);
+
+    // Filters the samples of a single lane in place.
+    void apply(size_t lane, double* data, size_t n);
+
+private:
+    void grow(size_t lanes);
+
+    std::vector<Biquad> _sections;
+    size_t _lanes { 0 };
+    size_t _capacity { 0 };
+    // State of section s, lane l at [s * _capacity + l].
+    std::vector<double> _z1;
+    std::vector<double> _z2;
+    // Scratch space for the interleaved samples of one apply() call.
+    std::vector<double> _x;
+};
+
+} // namespace DSP
+} // namespace GA
+
+#endif /* __GA_DSP_LANEFILTER_H__ */
@@ -0,0 +1,224 @@
+#include <ga/dsp/lanefilter.h>
+#include <ga/test/check.h>
+
+#include <seiscomp/core/version.h>
+#include <seiscomp/math/filter.h>
+#include <seiscomp/math/filter/butterworth.h>
+#include <seiscomp/math/filter/seismometers.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using GA::DSP::Biquad;
+using GA::DSP::LaneFilter;
+namespace Filtering = Seiscomp::Math::Filtering;
+
+namespace {
+
+// Largest magnitude difference accepted between the ga_dsp and the SeisComP
+// Wood-Anderson chain. Both use the bilinear transform but are designed
+// independently, so the peaks may differ slightly.
+const double MaxMagnitudeDifference = 0.005;
+
+// A local event recorded at fsamp: noise, then a burst with energy between
+// 0.2 and 8 Hz.
+std::vector<double> signal(double fsamp, double length, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::normal_distribution<double> noise(0.0, 1.0);
+
+    std::vector<double> data(static_cast<size_t>(length * fsamp));
+    const double frequencies[] { 0.2, 0.8, 2.0, 5.0, 8.0 };
+    for (size_t i = 0; i < data.size(); ++i) {
+        const double t = i / fsamp;
+        const double onset = t - length / 3;
+        double burst = 0;
+        if (onset > 0) {
+            for (double f : frequencies)
+                burst += std::sin(2 * M_PI * f * t + f) / f;
+            burst *= 200.0 * onset * std::exp(-onset / 4.0);
+        }
+        data[i] = burst + noise(random);
+    }
+    return data;
+}
+
+std::vector<double> filtered(const std::vector<Biquad>& sections, std::vector<double> data)
+{
+    LaneFilter filter(sections);
+    filter.apply(filter.addLane(), data.data(), data.size());
+    return data;
+}
+
+std::vector<double> filtered(Filtering::InPlaceFilter<double>& filter, double fsamp, std::vector<double> data)
+{
+    filter.setSamplingFrequency(fsamp);
+    filter.apply(static_cast<int>(data.size()), data.data());
+    return data;
+}
+
+Filtering::InPlaceFilter<double>* seiscompWoodAnderson(double gain, double T0, double h)
+{
+#if SC_API_VERSION >= SC_API_VERSION_CHECK(12, 0, 0)
+    return new Filtering::IIR::WoodAndersonFilter<double>(
+        Seiscomp::Math::Velocity, Seiscomp::Math::SeismometerResponse::WoodAnderson::Config(gain, T0, h));
+#else
+    // Older versions only know the standard response
+    return new Filtering::IIR::WoodAndersonFilter<double>(Seiscomp::Math::Velocity);
+#endif
+}
+
+double peak(const std::vector<double>& data)
+{
+    double result = 0;
+    for (double v : data)
+        result = std::max(result, std::fabs(v));
+    return result;
+}
+
+double maxDifference(const std::vector<double>& a, const std::vector<double>& b)
+{
+    double result = 0;
+    for (size_t i = 0; i < std::min(a.size(), b.size()); ++i)
+        result = std::max(result, std::fabs(a[i] - b[i]));
+    return result;
+}
+
+void testButterworthHighpass()
+{
+    for (double fsamp : { 40.0, 100.0, 200.0 }) {
+        for (int order : { 1, 2, 3, 4 }) {
+            for (double fc : { 0.5, 1.0 }) {
+                const std::vector<double> data = signal(fsamp, 60, order);
+                const std::vector<double> ours = filtered(GA::DSP::butterworthHighpass(order, fc, fsamp), data);
+
+                Filtering::IIR::ButterworthHighpass<double> reference(order, fc, fsamp);
+                const std::vector<double> theirs = filtered(reference, fsamp, data);
+
+                // Same design, so the same samples up to rounding
+                GA_CHECK(maxDifference(ours, theirs) <= 1e-6 * peak(theirs));
+            }
+        }
+    }
+
+    GA_CHECK(GA::DSP::butterworthHighpass(0, 1.0, 100.0).empty());
+    GA_CHECK(GA::DSP::butterworthHighpass(2, 50.0, 100.0).empty());
+    GA_CHECK(GA::DSP::butterworthHighpass(3, 1.0, 100.0).size() == 2);
+}
+
+void testWoodAnderson()
+{
+    for (double fsamp : { 40.0, 100.0, 200.0 }) {
+        const std::vector<double> data = signal(fsamp, 60, 7);
+        const std::vector<double> ours
+            = filtered({ GA::DSP::woodAndersonVelocity(fsamp, 2800, 0.8, 0.8) }, data);
+
+        std::unique_ptr<Filtering::InPlaceFilter<double>> reference(seiscompWoodAnderson(2800, 0.8, 0.8));
+        const std::vector<double> theirs = filtered(*reference, fsamp, data);
+
+        GA_CHECK_CLOSE(std::log10(peak(ours) / peak(theirs)), 0.0, MaxMagnitudeDifference);
+    }
+}
+
+void testMLaChain()
+{
+    std::vector<Biquad> sections;
+    GA_CHECK(GA::DSP::designMLaChain("", 100.0, 2800, 0.8, 0.8, sections));
+    GA_CHECK(sections.size() == 1);
+    GA_CHECK(GA::DSP::designMLaChain(" BW_HP( 3 , 0.5 ) ", 100.0, 2800, 0.8, 0.8, sections));
+    GA_CHECK(sections.size() == 3);
+    GA_CHECK(!GA::DSP::designMLaChain("BW(3,0.5,10)", 100.0, 2800, 0.8, 0.8, sections));
+    GA_CHECK(!GA::DSP::designMLaChain("BW_HP(3,0.5", 100.0, 2800, 0.8, 0.8, sections));
+    GA_CHECK(!GA::DSP::designMLaChain("BW_HP(3,0.5)>>BW_LP(3,10)", 100.0, 2800, 0.8, 0.8, sections));
+    GA_CHECK(!GA::DSP::designMLaChain("BW_HP(3,60)", 100.0, 2800, 0.8, 0.8, sections));
+
+    // The chain the MLv processor builds: prefilter, then Wood-Anderson
+    for (double fsamp : { 40.0, 100.0 }) {
+        const std::string preFilter = "BW_HP(3,0.5)";
+        const std::vector<double> data = signal(fsamp, 90, 11);
+
+        GA_CHECK(GA::DSP::designMLaChain(preFilter, fsamp, 2800, 0.8, 0.8, sections));
+        const std::vector<double> ours = filtered(sections, data);
+
+        std::string error;
+        std::unique_ptr<Filtering::InPlaceFilter<double>> pre(
+            Filtering::InPlaceFilter<double>::Create(preFilter, &error));
+        GA_CHECK(pre != nullptr);
+        if (!pre)
+            continue;
+        std::unique_ptr<Filtering::InPlaceFilter<double>> wa(seiscompWoodAnderson(2800, 0.8, 0.8));
+        const std::vector<double> theirs = filtered(*wa, fsamp, filtered(*pre, fsamp, data));
+
+        GA_CHECK_CLOSE(std::log10(peak(ours) / peak(theirs)), 0.0, MaxMagnitudeDifference);
+    }
+}
+
+void testLanes()
+{
+    std::vector<Biquad> sections;
+    GA::DSP::designMLaChain("BW_HP(4,1)", 100.0, 2800, 0.8, 0.8, sections);
+
+    // Lanes fed different lengths in one call filter like separate filters
+    const size_t lengths[] { 1000, 1, 250, 0, 999 };
+    std::vector<std::vector<double>> data;
+    for (size_t i = 0; i < 5; ++i) {
+        std::vector<double> d = signal(100.0, 10, static_cast<unsigned>(i));
+        d.resize(lengths[i]);
+        data.push_back(d);
+    }
+
+    LaneFilter filter(sections);
+    std::vector<size_t> lanes, n;
+    std::vector<std::vector<double>> samples = data;
+    std::vector<double*> pointers;
+    for (size_t i = 0; i < data.size(); ++i) {
+        lanes.push_back(filter.addLane());
+        n.push_back(samples[i].size());
+        pointers.push_back(samples[i].data());
+    }
+    // A lane order different from the IDs
+    std::reverse(lanes.begin(), lanes.end());
+    std::reverse(n.begin(), n.end());
+    std::reverse(pointers.begin(), pointers.end());
+    filter.apply(lanes.size(), lanes.data(), pointers.data(), n.data());
+
+    // The lockstep loop may round differently than the single lane one
+    bool same = true;
+    for (size_t i = 0; i < data.size(); ++i) {
+        const std::vector<double> single = filtered(sections, data[i]);
+        same = same && maxDifference(samples[i], single) <= 1e-12 * std::max(peak(single), 1.0);
+    }
+    GA_CHECK(same);
+
+    // Save and restore undo the filtering of a record
+    std::vector<double> first = signal(100.0, 5, 21), second = signal(100.0, 5, 22);
+    const size_t lane = filter.addLane();
+    filter.apply(lane, first.data(), first.size());
+    const std::vector<double> state = filter.save(lane);
+    std::vector<double> once = second, twice = second;
+    filter.apply(lane, once.data(), once.size());
+    filter.restore(lane, state);
+    filter.apply(lane, twice.data(), twice.size());
+    GA_CHECK(maxDifference(once, twice) == 0.0);
+
+    // Reset starts over like a new lane
+    std::vector<double> again = data[0];
+    filter.reset(lane);
+    filter.apply(lane, again.data(), again.size());
+    GA_CHECK(maxDifference(again, filtered(sections, data[0])) == 0.0);
+}
+
+} // namespace
+
+int main()
+{
+    testButterworthHighpass();
+    testWoodAnderson();
+    testMLaChain();
+    testLanes();
+    return GA::Test::result();
+}
@@ -0,0 +1,215 @@
+#include "featureindex.h"
+
+#include <seiscomp/geo/coordinate.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using Seiscomp::Geo::GeoCoordinate;
+using Seiscomp::Geo::GeoFeature;
+
+namespace GA {
+namespace Geo {
+
+namespace {
+
+bool indexable(const GeoFeature* f)
+{
+    return f && f->closedPolygon() && !f->vertices().empty();
+}
+
+} // namespace
+
+FeatureGrid::FeatureGrid(double cellSize)
+    : _cellSize(cellSize > 0 ? cellSize : 1.0)
+    , _rows(static_cast<int>(std::ceil(180.0 / _cellSize)))
+    , _columns(static_cast<int>(std::ceil(360.0 / _cellSize)))
+{
+}
+
+void FeatureGrid::clearGrid()
+{
+    _positions.clear();
+    _boxes.clear();
+    _cellStart.clear();
+    _cellFeatures.clear();
+}
+
+double FeatureGrid::normalizeLon(double lon)
+{
+    lon = std::fmod(lon, 360.0);
+    if (lon < -180.0)
+        lon += 360.0;
+    else if (lon >= 180.0)
+        lon -= 360.0;
+    return lon;
+}
+
+int FeatureGrid::row(double lat) const
+{
+    const int r = static_cast<int>(std::floor((lat + 90.0) / _cellSize));
+    return std::min(std::max(r, 0), _rows - 1);
+}
+
+int FeatureGrid::column(double lon) const
+{
+    const int c = static_cast<int>(std::floor((normalizeLon(lon) + 180.0) / _cellSize));
+    return std::min(std::max(c, 0), _columns - 1);
+}
+
+bool FeatureGrid::inBox(const Box& box, double lat, double lon)
+{
+    if (lat < box.south || lat > box.north)
+        return false;
+    return box.allLongitudes || (lon >= box.west && lon <= box.east);
+}
+
+void FeatureGrid::addBox(size_t pos, Box box)
+{
+    // Both tests handle longitude wrapping themselves, so anything not
+    // expressible as a plain [-180,180) interval is treated as covering
+    // all longitudes. This only costs extra exact tests.
+    if (box.west < -180.0 || box.east >= 180.0 || box.east - box.west > 180.0)
+        box.allLongitudes = true;
+
+    _positions.push_back(pos);
+    _boxes.push_back(box);
+}
+
+void FeatureGrid::buildCells()
+{
+    const size_t cellCount = size_t(_rows) * size_t(_columns);
+    std::vector<uint32_t> counts(cellCount + 1, 0);
+
+    // Two passes over the boxes: count the entries per cell, then fill the
+    // compressed lists. Feature indices are pushed in list order so every
+    // cell list stays sorted and lookups keep linear scan semantics.
+    for (int pass = 0; pass < 2; ++pass) {
+        if (pass == 1) {
+            _cellStart.assign(cellCount + 1, 0);
+            for (size_t c = 0; c < cellCount; ++c)
+                _cellStart[c + 1] = _cellStart[c] + counts[c];
+            _cellFeatures.resize(_cellStart[cellCount]);
+            std::copy(_cellStart.begin(), _cellStart.end() - 1, counts.begin());
+        }
+
+        for (size_t i = 0; i < _boxes.size(); ++i) {
+            const Box& box = _boxes[i];
+            const int r0 = row(box.south), r1 = row(box.north);
+            const int c0 = box.allLongitudes ? 0 : column(box.west);
+            const int c1 = box.allLongitudes ? _columns - 1 : column(box.east);
+
+            for (int r = r0; r <= r1; ++r) {
+                for (int c = c0; c <= c1; ++c) {
+                    const size_t cell = size_t(r) * _columns + c;
+                    if (pass == 0)
+                        ++counts[cell];
+                    else
+                        _cellFeatures[counts[cell]++] = static_cast<uint32_t>(i);
+                }
+            }
+        }
+    }
+}
+
+FeatureIndex::FeatureIndex(double cellSize)
+    : FeatureGrid(cellSize)
+{
+}
+
+void FeatureIndex::clear()
+{
+    clearGrid();
+    _features.clear();
+}
+
+void FeatureIndex::build(const std::vector<GeoFeature*>& features)
+{
+    build(std::vector<const GeoFeature*>(features.begin(), features.end()));
+}
+
+void FeatureIndex::build(const std::vector<const GeoFeature*>& features)
+{
+    clear();
+
+    for (size_t pos = 0; pos < features.size(); ++pos) {
+        const GeoFeature* f = features[pos];
+        if (!indexable(f))
+            continue;
+
+        Box box { std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(),
+            std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(), false };
+        for (const GeoCoordinate& v : f->vertices()) {
+            box.south = std::min(box.south, double(v.lat));
+            box.north = std::max(box.north, double(v.lat));
+            box.west = std::min(box.west, double(v.lon));
+            box.east = std::max(box.east, double(v.lon));
+        }
+
+        _features.push_back(f);
+        addBox(pos, box);
+    }
+
+    buildCells();
+}
+
+const GeoFeature* FeatureIndex::find(double lat, double lon) const
+{
+    const size_t i = locate(lat, lon);
+    return i == npos ? nullptr : _features[i];
+}
+
+size_t FeatureIndex::lookup(double lat, double lon) const
+{
+    return position(locate(lat, lon));
+}
+
+size_t FeatureIndex::locate(double lat, double lon) const
+{
+    return FeatureGrid::locate(lat, lon, [this](size_t i, double lat, double lon) {
+        return _features[i]->contains(GeoCoordinate(lat, lon));
+    });
+}
+
+PackedFeatureIndex::PackedFeatureIndex(double cellSize)
+    : FeatureGrid(cellSize)
+{
+}
+
+void PackedFeatureIndex::clear()
+{
+    clearGrid();
+    _arena.clear();
+}
+
+void PackedFeatureIndex::build(const std::vector<GeoFeature*>& features)
+{
+    build(std::vector<const GeoFeature*>(features.begin(), features.end()));
+}
+
+void PackedFeatureIndex::build(const std::vector<const GeoFeature*>& features)
+{
+    clear();
+
+    for (size_t pos = 0; pos < features.size(); ++pos) {
+        const GeoFeature* f = features[pos];
+        if (!indexable(f))
+            continue;
+
+        Box box { 0, 0, 0, 0, false };
+        _arena.bounds(_arena.add(*f), box.south, box.north, box.west, box.east);
+        addBox(pos, box);
+    }
+
+    buildCells();
+}
+
+size_t PackedFeatureIndex::lookup(double lat, double lon) const
+{
+    return position(FeatureGrid::locate(
+        lat, lon, [this](size_t i, double lat, double lon) { return _arena.contains(i, lat, lon); }));
+}
+
+} // namespace Geo
+} // namespace GA
@@ -0,0 +1,163 @@
+/*
+ * File:   featureindex.h
+ */
+
+#ifndef __GA_GEO_FEATUREINDEX_H__
+#define __GA_GEO_FEATUREINDEX_H__
+
+#include <seiscomp/geo/feature.h>
+
+#include "polygonarena.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace GA {
+namespace Geo {
+
+/*
+Grid of the bounding boxes of an ordered list of polygon features, shared by
+FeatureIndex and PackedFeatureIndex.
+
+The globe is divided into a regular lat/lon grid and every feature is
+registered in each cell its bounding box overlaps. A lookup only runs the exact
+test on the features registered in the cell of the query point, in list order,
+so the result is the same feature a linear scan over the list returns (the
+first closed polygon containing the point).
+*/
+class FeatureGrid {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // Number of indexed features.
+    size_t size() const { return _positions.size(); }
+    bool empty() const { return _positions.empty(); }
+
+protected:
+    struct Box {
+        double south, north, west, east;
+        // Set for boxes spanning the antimeridian or with unnormalised
+        // longitudes; those are registered in every column of their rows.
+        bool allLongitudes;
+    };
+
+    // @param cellSize: edge length of a grid cell in degrees.
+    explicit FeatureGrid(double cellSize);
+
+    void clearGrid();
+
+    // Adds the box of the feature at position pos of the list, features are
+    // added in list order. Its internal index is the number added before it.
+    void addBox(size_t pos, Box box);
+
+    // Builds the cell lists once all boxes are added.
+    void buildCells();
+
+    // Internal index of the first feature whose box holds the point and
+    // for which contains(index, lat, lon) is true, or npos.
+    template <typename Contains>
+    size_t locate(double lat, double lon, Contains contains) const;
+
+    // Position in the built list of the feature with the internal index i.
+    size_t position(size_t i) const { return i == npos ? npos : _positions[i]; }
+
+private:
+    int row(double lat) const;
+    int column(double lon) const;
+    static double normalizeLon(double lon);
+    static bool inBox(const Box& box, double lat, double lon);
+
+    double _cellSize;
+    int _rows;
+    int _columns;
+
+    std::vector<size_t> _positions;
+    std::vector<Box> _boxes;
+
+    // Compressed cell lists: the features of cell c are
+    // _cellFeatures[_cellStart[c] .. _cellStart[c+1]).
+    std::vector<uint32_t> _cellStart;
+    std::vector<uint32_t> _cellFeatures;
+};
+
+/*
+Point-in-polygon index running GeoFeature::contains as the exact test.
+
+The index does not own the features; they must outlive it.
+*/
+class FeatureIndex : public FeatureGrid {
+public:
+    // @param cellSize: edge length of a grid cell in degrees.
+    explicit FeatureIndex(double cellSize = 1.0);
+
+    // Indexes the given features, replacing any previous content. Features
+    // that are not closed polygons are ignored.
+    void build(const std::vector<const Seiscomp::Geo::GeoFeature*>& features);
+    void build(const std::vector<Seiscomp::Geo::GeoFeature*>& features);
+
+    void clear();
+
+    // Returns the first feature containing the point, or nullptr.
+    const Seiscomp::Geo::GeoFeature* find(double lat, double lon) const;
+
+    // Returns the position in the list passed to build() of the first
+    // feature containing the point, or npos.
+    size_t lookup(double lat, double lon) const;
+
+private:
+    size_t locate(double lat, double lon) const;
+
+    std::vector<const Seiscomp::Geo::GeoFeature*> _features;
+};
+
+/*
+Point-in-polygon index running PolygonArena::contains on a copy of the rings
+as the exact test. The features are only read by build() and may be released
+afterwards; no pointer to them is kept, so there is no find().
+*/
+class PackedFeatureIndex : public FeatureGrid {
+public:
+    // @param cellSize: edge length of a grid cell in degrees.
+    explicit PackedFeatureIndex(double cellSize = 1.0);
+
+    // Indexes the given features, replacing any previous content. Features
+    // that are not closed polygons are ignored.
+    void build(const std::vector<const Seiscomp::Geo::GeoFeature*>& features);
+    void build(const std::vector<Seiscomp::Geo::GeoFeature*>& features);
+
+    void clear();
+
+    // Returns the position in the list passed to build() of the first
+    // feature containing the point, or npos.
+    size_t lookup(double lat, double lon) const;
+
+    // Bytes held by the packed rings.
+    size_t packedSize() const { return _arena.memoryUsage(); }
+
+private:
+    // Polygon ID is the internal index.
+    PolygonArena _arena;
+};
+
+template <typename Contains>
+size_t FeatureGrid::locate(double lat, double lon, Contains contains) const
+{
+    if (_positions.empty())
+        return npos;
+
+    const size_t cell = size_t(row(lat)) * _columns + column(lon);
+    const double normLon = normalizeLon(lon);
+
+    for (uint32_t k = _cellStart[cell]; k < _cellStart[cell + 1]; ++k) {
+        const uint32_t i = _cellFeatures[k];
+        if (inBox(_boxes[i], lat, normLon) && contains(i, lat, lon))
+            return i;
+    }
+
+    return npos;
+}
+
+} // namespace Geo
+} // namespace GA
+
+#endif /* __GA_GEO_FEATUREINDEX_H__ */
@@ -0,0 +1,256 @@
+#include "polygonarena.h"
+
+#include <seiscomp/geo/coordinate.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using Seiscomp::Geo::GeoCoordinate;
+using Seiscomp::Geo::GeoFeature;
+
+namespace GA {
+namespace Geo {
+
+namespace {
+
+// Rings with fewer edges are cheap enough to test directly
+const uint32_t MIN_GRID_EDGES = 32;
+// Cells per axis at most
+const int MAX_GRID_SIZE = 64;
+// Degrees an edge is widened by when marking boundary cells, far above the
+// rounding errors of the single precision test.
+const double MARGIN = 1e-3;
+
+int clampIndex(double value, int size)
+{
+    return std::min(std::max(static_cast<int>(std::floor(value)), 0), size - 1);
+}
+
+} // namespace
+
+void PolygonArena::clear()
+{
+    _lon.clear();
+    _lat.clear();
+    _rings.clear();
+    _polygonStart.clear();
+    _cells.clear();
+}
+
+size_t PolygonArena::add(const GeoFeature& feature)
+{
+    if (_polygonStart.empty())
+        _polygonStart.push_back(0);
+
+    const std::vector<GeoCoordinate>& vertices = feature.vertices();
+
+    // Ring boundaries: the feature starts a ring at 0 and at every sub
+    // feature index.
+    std::vector<size_t> starts(feature.subFeatures().begin(), feature.subFeatures().end());
+    starts.push_back(0);
+    starts.push_back(vertices.size());
+    std::sort(starts.begin(), starts.end());
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+    for (size_t s = 0; s + 1 < starts.size(); ++s) {
+        const size_t first = starts[s];
+        const size_t last = std::min(starts[s + 1], vertices.size());
+        if (last - first < 3)
+            continue;
+
+        Ring ring;
+        ring.begin = static_cast<uint32_t>(_lon.size());
+        ring.south = ring.west = std::numeric_limits<float>::max();
+        ring.north = ring.east = std::numeric_limits<float>::lowest();
+
+        double lon = vertices[first].lon;
+        for (size_t i = first; i <= last; ++i) {
+            // The last iteration closes the ring with the first vertex
+            const GeoCoordinate& v = vertices[i < last ? i : first];
+            if (i > first) {
+                lon += std::remainder(double(v.lon) - double(vertices[i - 1].lon), 360.0);
+            }
+
+            const float x = static_cast<float>(lon);
+            const float y = static_cast<float>(v.lat);
+            _lon.push_back(x);
+            _lat.push_back(y);
+            if (i < last) {
+                ring.south = std::min(ring.south, y);
+                ring.north = std::max(ring.north, y);
+                ring.west = std::min(ring.west, x);
+                ring.east = std::max(ring.east, x);
+            }
+        }
+
+        // Rings encircling a pole end a full turn away from their first
+        // vertex after unwrapping. The crossing-number test cannot represent
+        // them; close them so that at least the ring stays well formed.
+        _lon.back() = _lon[ring.begin];
+        ring.end = static_cast<uint32_t>(_lon.size() - 1);
+        buildGrid(ring);
+        _rings.push_back(ring);
+    }
+
+    _polygonStart.push_back(static_cast<uint32_t>(_rings.size()));
+    return _polygonStart.size() - 2;
+}
+
+void PolygonArena::buildGrid(Ring& ring)
+{
+    ring.grid = 0;
+    ring.rows = ring.columns = 0;
+    ring.cellsPerLat = ring.cellsPerLon = 0;
+
+    const uint32_t edges = ring.end - ring.begin;
+    const double height = double(ring.north) - double(ring.south);
+    const double width = double(ring.east) - double(ring.west);
+    if (edges < MIN_GRID_EDGES || !(height > 0) || !(width > 0))
+        return;
+
+    // About one cell per edge, shaped like the bounding box
+    const double cells = std::min(double(edges), double(MAX_GRID_SIZE * MAX_GRID_SIZE));
+    const int columns = std::min(
+        std::max(static_cast<int>(std::lround(std::sqrt(cells * width / height))), 1),
+        MAX_GRID_SIZE);
+    const int rows
+        = std::min(std::max(static_cast<int>(std::lround(cells / columns)), 1), MAX_GRID_SIZE);
+    const double cellHeight = height / rows;
+    const double cellWidth = width / columns;
+
+    ring.grid = static_cast<uint32_t>(_cells.size());
+    ring.rows = static_cast<uint16_t>(rows);
+    ring.columns = static_cast<uint16_t>(columns);
+    ring.cellsPerLat = static_cast<float>(rows / height);
+    ring.cellsPerLon = static_cast<float>(columns / width);
+    _cells.resize(_cells.size() + size_t(rows) * columns, Outside);
+    Cell* grid = _cells.data() + ring.grid;
+
+    // Mark the cells each edge passes within MARGIN of, row by row
+    for (uint32_t i = ring.begin; i < ring.end; ++i) {
+        const double x0 = _lon[i], y0 = _lat[i];
+        const double x1 = _lon[i + 1], y1 = _lat[i + 1];
+        const double ymin = std::min(y0, y1), ymax = std::max(y0, y1);
+        const int r0 = clampIndex((ymin - MARGIN - ring.south) / cellHeight, rows);
+        const int r1 = clampIndex((ymax + MARGIN - ring.south) / cellHeight, rows);
+
+        for (int r = r0; r <= r1; ++r) {
+            // Longitudes of the edge where it enters and leaves the row
+            double xa = x0, xb = x1;
+            if (y1 != y0) {
+                const double a = std::min(
+                    std::max(ring.south + r * cellHeight - MARGIN, ymin), ymax);
+                const double b = std::min(
+                    std::max(ring.south + (r + 1) * cellHeight + MARGIN, ymin), ymax);
+                xa = x0 + (a - y0) * (x1 - x0) / (y1 - y0);
+                xb = x0 + (b - y0) * (x1 - x0) / (y1 - y0);
+            }
+
+            const int c0 = clampIndex((std::min(xa, xb) - MARGIN - ring.west) / cellWidth, columns);
+            const int c1 = clampIndex((std::max(xa, xb) + MARGIN - ring.west) / cellWidth, columns);
+            for (int c = c0; c <= c1; ++c)
+                grid[size_t(r) * columns + c] = Boundary;
+        }
+    }
+
+    // No edge crosses the other cells, so their centre decides for all of
+    // their points.
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            Cell& cell = grid[size_t(r) * columns + c];
+            if (cell == Boundary)
+                continue;
+            const float lat = static_cast<float>(ring.south + (r + 0.5) * cellHeight);
+            const float lon = static_cast<float>(ring.west + (c + 0.5) * cellWidth);
+            cell = ringContains(ring, lat, lon) ? Inside : Outside;
+        }
+    }
+}
+
+PolygonArena::Cell PolygonArena::cell(const Ring& ring, float lat, float lon) const
+{
+    if (ring.rows == 0)
+        return Boundary;
+
+    const int r = clampIndex((lat - ring.south) * ring.cellsPerLat, ring.rows);
+    const int c = clampIndex((lon - ring.west) * ring.cellsPerLon, ring.columns);
+    return _cells[ring.grid + size_t(r) * ring.columns + c];
+}
+
+bool PolygonArena::ringContains(const Ring& ring, float lat, float lon) const
+{
+    const float* x = _lon.data();
+    const float* y = _lat.data();
+
+    // Counts the edges crossed by a ray from the point towards increasing
+    // longitude. For an edge straddling the point's latitude, the crossing
+    // lies east of the point if (lon - x0) * (y1 - y0) and
+    // (x1 - x0) * (lat - y0) compare the same way as y1 and y0.
+    unsigned crossings = 0;
+    for (uint32_t i = ring.begin; i < ring.end; ++i) {
+        const float x0 = x[i], y0 = y[i];
+        const float x1 = x[i + 1], y1 = y[i + 1];
+        const bool above0 = y0 > lat;
+        const bool above1 = y1 > lat;
+        const float lhs = (lon - x0) * (y1 - y0);
+        const float rhs = (x1 - x0) * (lat - y0);
+        const bool east = above1 ? lhs < rhs : lhs > rhs;
+        crossings += static_cast<unsigned>((above0 != above1) & east);
+    }
+
+    return crossings & 1u;
+}
+
+bool PolygonArena::contains(size_t polygon, double lat, double lon) const
+{
+    if (polygon >= size())
+        return false;
+
+    const float flat = static_cast<float>(lat);
+    bool inside = false;
+
+    for (uint32_t r = _polygonStart[polygon]; r < _polygonStart[polygon + 1]; ++r) {
+        const Ring& ring = _rings[r];
+        if (flat < ring.south || flat > ring.north)
+            continue;
+
+        // Shift the longitude into the unwrapped range of the ring
+        double shifted = ring.west + std::fmod(std::fmod(lon - ring.west, 360.0) + 360.0, 360.0);
+        const float flon = static_cast<float>(shifted);
+        if (flon > ring.east)
+            continue;
+
+        const Cell c = cell(ring, flat, flon);
+        if (c == Boundary ? ringContains(ring, flat, flon) : c == Inside)
+            inside = !inside;
+    }
+
+    return inside;
+}
+
+void PolygonArena::bounds(
+    size_t polygon, double& south, double& north, double& west, double& east) const
+{
+    south = west = std::numeric_limits<double>::max();
+    north = east = std::numeric_limits<double>::lowest();
+    if (polygon >= size())
+        return;
+
+    for (uint32_t r = _polygonStart[polygon]; r < _polygonStart[polygon + 1]; ++r) {
+        const Ring& ring = _rings[r];
+        south = std::min(south, double(ring.south));
+        north = std::max(north, double(ring.north));
+        west = std::min(west, double(ring.west));
+        east = std::max(east, double(ring.east));
+    }
+}
+
+size_t PolygonArena::memoryUsage() const
+{
+    return (_lon.capacity() + _lat.capacity()) * sizeof(float) + _rings.capacity() * sizeof(Ring)
+        + _polygonStart.capacity() * sizeof(uint32_t) + _cells.capacity() * sizeof(Cell);
+}
+
+} // namespace Geo
+} // namespace GA
@@ -0,0 +1,95 @@
+/*
+ * File:   polygonarena.h
+ */
+
+#ifndef __GA_GEO_POLYGONARENA_H__
+#define __GA_GEO_POLYGONARENA_H__
+
+#include <seiscomp/geo/feature.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace GA {
+namespace Geo {
+
+/*
+Compact copy of the rings of polygon features for point-in-polygon tests.
+
+All vertices live in two contiguous float arrays (longitude, latitude), each
+ring closed by repeating its first vertex and carrying its own bounding box.
+Longitudes are unwrapped along each ring, so consecutive vertices never differ
+by more than 180 degrees and rings crossing the antimeridian need no special
+case; the query longitude is shifted by a multiple of 360 degrees into the
+ring's longitude range instead.
+
+A point is inside a polygon if it is inside an odd number of its rings (even-
+odd rule), which covers holes and multi-part features. The per-ring test is a
+branch-free crossing-number loop over the edge arrays that compilers vectorise.
+
+Rings with many edges also get a coarse grid over their bounding box, built
+when they are added. Each cell is marked inside or outside if no edge comes
+near it, boundary otherwise. The inside cells form a conservative inner
+generalisation of the ring and the inside and boundary cells an outer one:
+points in inside or outside cells are decided by one lookup, only points in
+the band along the edges run the full resolution test, with the same result.
+
+Coordinates are stored in single precision, about 1 m at the equator, so
+points that close to an edge may be classified differently than by
+GeoFeature::contains.
+*/
+class PolygonArena {
+public:
+    // Copies the rings of a closed polygon feature and returns its polygon
+    // ID, the number of polygons added before it.
+    size_t add(const Seiscomp::Geo::GeoFeature& feature);
+
+    void clear();
+
+    bool contains(size_t polygon, double lat, double lon) const;
+
+    // Bounding box of a polygon; west and east are unwrapped longitudes and
+    // may lie outside [-180, 180].
+    void bounds(size_t polygon, double& south, double& north, double& west, double& east) const;
+
+    size_t size() const { return _polygonStart.empty() ? 0 : _polygonStart.size() - 1; }
+    size_t vertexCount() const { return _lon.size(); }
+
+    // Bytes held by the arena.
+    size_t memoryUsage() const;
+
+private:
+    enum Cell : uint8_t { Outside, Inside, Boundary };
+
+    struct Ring {
+        uint32_t begin; // first vertex, the ring has end - begin edges
+        uint32_t end;   // vertex repeating the first one
+        float south, north, west, east;
+        // Grid cells _cells[grid .. grid + rows * columns), row major from
+        // south-west; rows == 0 if the ring has no grid.
+        uint32_t grid;
+        uint16_t rows, columns;
+        float cellsPerLat, cellsPerLon;
+    };
+
+    bool ringContains(const Ring& ring, float lat, float lon) const;
+
+    // Classifies the cells of a ring, see the class comment.
+    void buildGrid(Ring& ring);
+
+    // Cell of a point in the bounding box of a ring, Boundary without grid.
+    Cell cell(const Ring& ring, float lat, float lon) const;
+
+    std::vector<float> _lon;
+    std::vector<float> _lat;
+    std::vector<Ring> _rings;
+    // Rings of polygon p are _rings[_polygonStart[p] .. _polygonStart[p+1]).
+    std::vector<uint32_t> _polygonStart;
+    std::vector<Cell> _cells;
+};
+
+} // namespace Geo
+} // namespace GA
+
+#endif /* __GA_GEO_POLYGONARENA_H__ */
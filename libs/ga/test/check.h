@@ -0,0 +1,64 @@
+/*
+ * File:   check.h
+ */
+
+#ifndef __GA_TEST_CHECK_H__
+#define __GA_TEST_CHECK_H__
+
+#include <cmath>
+#include <cstdio>
+
+/*
+Assertions of the unit tests of the GA libraries and plugins. They need no
+test framework, so that the ga_core tests also build without SeisComP and
+Boost. A failed check is reported and counted, the test carries on; main()
+returns GA::Test::result().
+*/
+
+#define GA_CHECK(condition) GA::Test::check((condition), #condition, __FILE__, __LINE__)
+
+#define GA_CHECK_CLOSE(a, b, tolerance)                                                       \
+    GA::Test::check(std::fabs(double(a) - double(b)) <= (tolerance),                          \
+        #a " == " #b " within " #tolerance, __FILE__, __LINE__)
+
+#define GA_CHECK_THROWS(expression, Exception)                                                \
+    do {                                                                                      \
+        bool thrown = false;                                                                  \
+        try {                                                                                 \
+            expression;                                                                       \
+        } catch (const Exception&) {                                                         \
+            thrown = true;                                                                    \
+        }                                                                                     \
+        GA::Test::check(thrown, #expression " throws " #Exception, __FILE__, __LINE__);       \
+    } while (false)
+
+namespace GA {
+namespace Test {
+
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+inline bool check(bool passed, const char* text, const char* file, int line)
+{
+    if (!passed) {
+        ++failures();
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+    }
+    return passed;
+}
+
+inline int result()
+{
+    if (failures() == 0)
+        return 0;
+    std::fprintf(stderr, "%d check(s) failed\n", failures());
+    return 1;
+}
+
+} // namespace Test
+} // namespace GA
+
+#endif /* __GA_TEST_CHECK_H__ */
@@ -0,0 +1,168 @@
+#include "trace.h"
+
+#include <seiscomp/system/environment.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace GA {
+namespace Trace {
+
+namespace {
+
+// Spans buffered before they are appended to the file
+constexpr size_t FlushThreshold = 4096;
+
+int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+uint32_t threadID()
+{
+    return static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()) & 0x7fffffff);
+}
+
+struct Event {
+    const char* category;
+    const char* name;
+    int64_t start;
+    int64_t duration;
+    uint32_t tid;
+};
+
+class Writer {
+public:
+    static Writer& Instance()
+    {
+        static Writer writer;
+        return writer;
+    }
+
+    ~Writer() { flush(); }
+
+    void add(const Event& event)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _events.push_back(event);
+        if (_events.size() >= FlushThreshold)
+            write();
+    }
+
+    void flush()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        write();
+    }
+
+private:
+    Writer()
+        : _pid(static_cast<int>(getpid()))
+    {
+        const char* path = std::getenv("GA_TRACE_FILE");
+        if (path && *path)
+            _path = path;
+        else
+            _path = Seiscomp::Environment::Instance()->logDir() + "/ga-trace.json";
+        _events.reserve(FlushThreshold);
+    }
+
+    int open()
+    {
+        int fd = ::open(_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND, 0644);
+        if (fd >= 0) {
+            // This process created the file and opens the event array
+            if (::write(fd, "[\n", 2) != 2) {
+                ::close(fd);
+                return -1;
+            }
+            return fd;
+        }
+        if (errno != EEXIST)
+            return -1;
+        return ::open(_path.c_str(), O_WRONLY | O_APPEND);
+    }
+
+    // Appends the buffered events as one write() so that chunks of
+    // concurrently tracing processes do not interleave.
+    void write()
+    {
+        if (_events.empty() || _failed)
+            return;
+
+        std::string out;
+        out.reserve(_events.size() * 128);
+
+        char line[512];
+        if (!_named) {
+#ifdef __GLIBC__
+            std::snprintf(line, sizeof(line),
+                "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s\"}},\n",
+                _pid, program_invocation_short_name);
+            out += line;
+#endif
+            _named = true;
+        }
+
+        for (const Event& e : _events) {
+            std::snprintf(line, sizeof(line),
+                "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,"
+                "\"pid\":%d,\"tid\":%u},\n",
+                e.name, e.category, static_cast<long long>(e.start),
+                static_cast<long long>(e.duration), _pid, e.tid);
+            out += line;
+        }
+        _events.clear();
+
+        const int fd = open();
+        if (fd < 0) {
+            std::fprintf(stderr, "GA trace: cannot write %s, tracing disabled\n", _path.c_str());
+            _failed = true;
+            return;
+        }
+        if (::write(fd, out.data(), out.size()) != static_cast<ssize_t>(out.size()))
+            std::fprintf(stderr, "GA trace: short write to %s\n", _path.c_str());
+        ::close(fd);
+    }
+
+    std::mutex _mutex;
+    std::vector<Event> _events;
+    std::string _path;
+    int _pid;
+    bool _named { false };
+    bool _failed { false };
+};
+
+} // namespace
+
+Span::Span(const char* category, const char* name)
+    : _category(category)
+    , _name(name)
+    , _start(now())
+{
+}
+
+Span::~Span()
+{
+    Writer::Instance().add({ _category, _name, _start, now() - _start, threadID() });
+}
+
+void flush()
+{
+    Writer::Instance().flush();
+}
+
+} // namespace Trace
+} // namespace GA
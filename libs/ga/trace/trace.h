@@ -0,0 +1,70 @@
+/*
+ * File:   trace.h
+ */
+
+#ifndef __GA_TRACE_TRACE_H__
+#define __GA_TRACE_TRACE_H__
+
+/*
+Scoped trace spans for the GA plugins, written as Chrome trace-event JSON.
+
+Built only with the CMake option GA_TRACING. Without it GA_TRACE_SCOPE expands
+to an empty statement and the plugins do not link the trace library.
+
+    void Processor::compute()
+    {
+        GA_TRACE_SCOPE("mla", "Processor::compute");
+        ...
+    }
+
+Spans are buffered per process and appended to the trace file in chunks and
+when the process exits. The file is ga-trace.json in the SeisComP log
+directory unless the environment variable GA_TRACE_FILE names another one.
+Processes tracing at the same time (e.g. scamp, scmag and scevent) append to
+the same file, so their timelines can be viewed together; timestamps are wall
+clock time. Remove the file between runs, the first process to create it
+writes the opening bracket.
+*/
+
+#ifdef GA_TRACING
+
+#include <cstdint>
+
+namespace GA {
+namespace Trace {
+
+class Span {
+public:
+    // Both strings must outlive the process, i.e. be literals
+    Span(const char* category, const char* name);
+    ~Span();
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* _category;
+    const char* _name;
+    int64_t _start;
+};
+
+// Appends all buffered spans to the trace file.
+void flush();
+
+} // namespace Trace
+} // namespace GA
+
+#define GA_TRACE_CONCAT_(a, b) a##b
+#define GA_TRACE_CONCAT(a, b) GA_TRACE_CONCAT_(a, b)
+#define GA_TRACE_SCOPE(category, name) \
+    ::GA::Trace::Span GA_TRACE_CONCAT(gaTraceSpan, __LINE__)(category, name)
+
+#else
+
+#define GA_TRACE_SCOPE(category, name) \
+    do {                               \
+    } while (0)
+
+#endif
+
+#endif /* __GA_TRACE_TRACE_H__ */
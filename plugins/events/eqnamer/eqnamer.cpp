@@ -22,12 +22,24 @@
 #include <seiscomp/math/coord.h>
 #include <seiscomp/math/geo.h>
 #include <seiscomp/plugins/events/eventprocessor.h>
-#include <seiscomp/processing/regions.h>
 #include <seiscomp/system/environment.h>
 #include <seiscomp/utils/replace.h>
 
+#include <ga/core/naming.h>
+#include <ga/core/pointindex.h>
+#include <ga/geo/featureindex.h>
+#include <ga/alloc/alloc.h>
+#include <ga/trace/trace.h>
+
 #include <algorithm>
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 using Seiscomp::Environment;
@@ -45,70 +57,77 @@ using Seiscomp::DataModel::REVIEWED;
 using Seiscomp::Geo::GeoFeature;
 using Seiscomp::IO::XMLArchive;
 using Seiscomp::Math::Geo::CityD;
-using Seiscomp::Processing::Regions;
 
 ADD_SC_PLUGIN("Earthquake Namer", "Anthony Carapetis <anthony.carapetis@ga.gov.au>", 0, 0, 2)
 
+// Cities as parallel arrays. Names and countries are interned: each
+// distinct string is stored once and referenced by its position in strings.
+struct CityStore {
+    std::vector<double> lat;
+    std::vector<double> lon;
+    std::vector<uint32_t> name;
+    std::vector<uint32_t> country;
+    std::vector<std::string> strings;
+
+    size_t size() const { return lat.size(); }
+    bool empty() const { return lat.empty(); }
+
+    void clear()
+    {
+        lat.clear();
+        lon.clear();
+        name.clear();
+        country.clear();
+        strings.clear();
+        _interned.clear();
+    }
+
+    void add(const CityD& city)
+    {
+        lat.push_back(city.lat);
+        lon.push_back(city.lon);
+        name.push_back(intern(city.name()));
+        country.push_back(intern(city.countryID()));
+    }
+
+    const std::string& nameOf(size_t i) const { return strings[name[i]]; }
+    const std::string& countryOf(size_t i) const { return strings[country[i]]; }
+
+private:
+    uint32_t intern(const std::string& s)
+    {
+        auto it = _interned.find(s);
+        if (it != _interned.end())
+            return it->second;
+        const uint32_t id = static_cast<uint32_t>(strings.size());
+        strings.push_back(s);
+        _interned.emplace(s, id);
+        return id;
+    }
+
+    std::unordered_map<std::string, uint32_t> _interned;
+};
+
 struct CityRel {
     double distDeg;
     double azi;
-    std::string name;
-    std::string country;
+    size_t city;
 };
 
+// The general variables of SeisComP (e.g. @hostname@) and those of the name
+// templates (GA::Core::NameVariables).
 struct Resolver : public Seiscomp::Util::VariableResolver {
-    const int& _dist;
-    const std::string& _name;
-    const std::string& _poiCountry;
-    const std::string& _epiDescription;
-    std::string _dir;
+    GA::Core::NameVariables _variables;
 
     Resolver(const int& dist, const double& azi, const std::string& name,
         const std::string& poiCountry, const std::string& epiDescription)
-        : _dist(dist)
-        , _name(name)
-        , _poiCountry(poiCountry)
-        , _epiDescription(epiDescription)
+        : _variables(dist, azi, name, poiCountry, epiDescription)
     {
-        if (azi < 22.5 || azi > 360.0 - 22.5)
-            _dir = "N";
-        else if (azi >= 22.5 && azi <= 90.0 - 22.5)
-            _dir = "NE";
-        else if (azi > 90.0 - 22.5 && azi < 90.0 + 22.5)
-            _dir = "E";
-        else if (azi >= 90.0 + 22.5 && azi <= 180.0 - 22.5)
-            _dir = "SE";
-        else if (azi > 180.0 - 22.5 && azi < 180.0 + 22.5)
-            _dir = "S";
-        else if (azi >= 180.0 + 22.5 && azi <= 270.0 - 22.5)
-            _dir = "SW";
-        else if (azi > 270.0 - 22.5 && azi < 270.0 + 22.5)
-            _dir = "W";
-        else if (azi >= 270.0 + 22.5 && azi <= 360.0 - 22.5)
-            _dir = "NW";
-        else
-            _dir = "?";
     }
 
     bool resolve(std::string& variable) const
     {
-        if (VariableResolver::resolve(variable))
-            return true;
-
-        if (variable == "dist")
-            variable = toString(_dist);
-        else if (variable == "dir")
-            variable = _dir;
-        else if (variable == "poi")
-            variable = _name;
-        else if (variable == "poi_country")
-            variable = _poiCountry;
-        else if (variable == "epi_description")
-            variable = _epiDescription;
-        else
-            return false;
-
-        return true;
+        return VariableResolver::resolve(variable) || _variables.resolve(variable);
     }
 };
 
@@ -124,12 +143,7 @@ static std::string getAttr(const GeoFeature& f, const std::string& key)
 
 static std::string crustTypeLabel(const GeoFeature& f)
 {
-    const std::string t = getAttr(f, "Crust_Type");
-    if (t == "Coastal")
-        return "Coastal";
-    else if (t == "Oceanic")
-        return "Offshore";
-    return "";
+    return GA::Core::crustLabel(getAttr(f, "Crust_Type"));
 }
 
 static std::string getFeatureName(const GeoFeature& f)
@@ -143,7 +157,29 @@ static std::string getFeatureName(const GeoFeature& f)
     return "";
 }
 
-using Template = std::vector<std::string>;
+using GA::Core::Template;
+
+// The origin attributes a name depends on, read on scevent's thread so that
+// names can be computed on another one.
+struct NamingInput {
+    std::string originID;
+    double lat;
+    double lon;
+    bool precise;
+    std::string status;
+
+    bool operator==(const NamingInput& other) const
+    {
+        return originID == other.originID && lat == other.lat && lon == other.lon
+            && precise == other.precise;
+    }
+};
+
+struct Naming {
+    std::string name;
+    // Only set for precise (reviewed or final) origins
+    std::string nearbyPlaces;
+};
 
 struct TemplatePair {
     Template approximate;
@@ -177,22 +213,49 @@ static Template getStringsOrDefault(
 
 class EQNamer : public Seiscomp::Client::EventProcessor {
 protected:
-    std::vector<CityD> _cities;
-    Regions _staticRegions;
-    Regions _dynamicRegions;
-    Regions _countries;
+    CityStore _cities;
+    // Attributes of the polygon layers, by position in the list passed to
+    // the respective index. The features themselves are released after
+    // setup; the indexes keep packed copies of their rings.
+    std::vector<std::string> _staticNames;
+    std::vector<std::string> _dynamicCrustLabels;
+    std::vector<std::string> _countryNames;
+
+    GA::Core::PointIndex _cityIndex;
+    GA::Geo::PackedFeatureIndex _staticIndex { 1.0 };
+    GA::Geo::PackedFeatureIndex _dynamicIndex { 1.0 };
+    GA::Geo::PackedFeatureIndex _countryIndex { 1.0 };
 
     std::string _homeCountry;
     TemplateSet _templates;
     Template _nearbyPlaceTemplate;
 
+    // Names computed in the background from preferredMagnitude(), by origin ID
+    struct Precomputed {
+        NamingInput input;
+        bool ready;
+        Naming naming;
+    };
+
+    static const size_t MaxPrecomputed = 256;
+
+    bool _precompute = false;
+    std::thread _worker;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::deque<NamingInput> _queue;
+    std::map<std::string, Precomputed> _precomputed;
+    std::deque<std::string> _precomputedOrder;
+    bool _stopping = false;
+    size_t _hits = 0;
+    size_t _misses = 0;
+
     std::string countryFor(double lat, double lon) const
     {
-        if (_countries.featureSet.features().empty())
+        if (_countryIndex.empty())
             return "";
-        if (auto f = _countries.find(lat, lon))
-            return getAttr(*f, "CNTRY_NAME");
-        return "";
+        const size_t pos = _countryIndex.lookup(lat, lon);
+        return pos != GA::Geo::PackedFeatureIndex::npos ? _countryNames[pos] : "";
     }
 
     const Template& selectTemplate(
@@ -204,107 +267,128 @@ protected:
         return precise ? pair.precise : pair.approximate;
     }
 
-    std::string nameEvent(Event* event)
+    static NamingInput namingInput(const Origin* o)
     {
-        OriginPtr o = Origin::Find(event->preferredOriginID());
-        return nameOrigin(o.get(), event->publicID().c_str());
+        NamingInput input;
+        input.originID = o->publicID();
+        input.lat = o->latitude().value();
+        input.lon = o->longitude().value();
+        try {
+            const auto status = o->evaluationStatus();
+            input.precise = status == REVIEWED || status == FINAL;
+            input.status = status.toString();
+        } catch (...) {
+            input.precise = false;
+            input.status = "blank";
+        }
+        return input;
     }
 
-    std::string nameOrigin(Origin* o, const char* const evid)
+    // Names the origin; log lines start with context(id), the caller and the
+    // event or origin it names for
+    Naming computeNaming(
+        const NamingInput& input, const char* const context, const char* const id) const
     {
-        const double lat = o->latitude().value();
-        const double lon = o->longitude().value();
-
-        if (const auto f = _dynamicRegions.find(lat, lon)) {
-            bool precise;
-            std::string statusStr;
-            try {
-                const auto status = o->evaluationStatus();
-                precise = status == REVIEWED || status == FINAL;
-                statusStr = status.toString();
-            } catch (...) {
-                precise = false;
-                statusStr = "blank";
-            }
-
-            SEISCOMP_INFO(
-                "EQNamer::process(%s): Status is %s, naming by nearest city with precise=%s", evid,
-                statusStr, precise ? "true" : "false");
+        Naming naming;
+        naming.name = nameOrigin(input, context, id);
+        if (input.precise)
+            naming.nearbyPlaces = nearbyCitiesString(input.lat, input.lon);
+        return naming;
+    }
 
-            const std::string crust = crustTypeLabel(*f);
-            return nameByNearestCity(lat, lon, crust, precise);
+    std::string nameOrigin(
+        const NamingInput& input, const char* const context, const char* const evid) const
+    {
+        GA_TRACE_SCOPE("eqnamer", "EQNamer::nameOrigin");
+        GA_ALLOC_SCOPE("eqnamer", "EQNamer::nameOrigin");
+        const double lat = input.lat;
+        const double lon = input.lon;
+
+        const size_t dynamic = _dynamicIndex.lookup(lat, lon);
+        if (dynamic != GA::Geo::PackedFeatureIndex::npos) {
+            SEISCOMP_INFO("%s(%s): Status is %s, naming by nearest city with precise=%s", context,
+                evid, input.status, input.precise ? "true" : "false");
+
+            const std::string& crust = _dynamicCrustLabels[dynamic];
+            return nameByNearestCity(lat, lon, crust, input.precise);
         }
 
-        SEISCOMP_INFO("EQNamer::process(%s): Naming by polygon", evid);
-        if (auto region = _staticRegions.find(lat, lon)) {
-            return getFeatureName(*region);
+        SEISCOMP_INFO("%s(%s): Naming by polygon", context, evid);
+        const size_t region = _staticIndex.lookup(lat, lon);
+        if (region != GA::Geo::PackedFeatureIndex::npos) {
+            return _staticNames[region];
         } else {
-            SEISCOMP_ERROR(
-                "EQNamer::process(%s): No polygon containing %0.1f, %0.1f", evid, lon, lat);
+            SEISCOMP_ERROR("%s(%s): No polygon containing %0.1f, %0.1f", context, evid, lon, lat);
             return "Unknown Region";
         }
     }
 
     std::string cityRelativeDescription(const Template& templ, const CityRel& cr,
-        const std::string& epiCountry, const std::string& crustLabel, bool precise)
+        const std::string& epiCountry, const std::string& crustLabel, bool precise) const
     {
         int distkm = Seiscomp::Math::Geo::deg2km(cr.distDeg);
-        const bool skipEpiCountry = epiCountry.empty() || epiCountry == _homeCountry;
-        const std::string epiDesc = skipEpiCountry ? crustLabel
-            : crustLabel.empty()                   ? epiCountry
-                                                   : crustLabel + " " + epiCountry;
-        const auto resolver = Resolver(distkm, cr.azi, cr.name, cr.country, epiDesc);
-        std::string s = "";
-        bool first = true;
-        for (const std::string& templPart : templ) {
-            std::string part = Seiscomp::Util::replace(templPart, resolver);
-            if (!part.empty()) {
-                if (first) {
-                    first = false;
-                } else {
-                    s += ", ";
-                }
-                s += part;
-            }
+        const std::string epiDesc
+            = GA::Core::epicentreDescription(epiCountry, _homeCountry, crustLabel);
+        const auto resolver = Resolver(
+            distkm, cr.azi, _cities.nameOf(cr.city), _cities.countryOf(cr.city), epiDesc);
+        return GA::Core::joinTemplate(templ, [&](const std::string& part) {
+            return Seiscomp::Util::replace(part, resolver);
+        });
+    }
+
+    // Returns up to count cities closest to (lat, lon), closest first, ranked by
+    // delazi distance exactly as a linear scan over _cities would rank them.
+    std::vector<CityRel> closestCities(double lat, double lon, size_t count) const
+    {
+        std::vector<CityRel> rels;
+        const std::vector<size_t> nearest = _cityIndex.nearest(lat, lon, count);
+        if (nearest.empty())
+            return rels;
+
+        // The index ranks by spherical distance. Widen the radius slightly so
+        // that no city delazi would rank among the closest is missed.
+        const double radius = _cityIndex.distance(nearest.back(), lat, lon) * 1.01 + 0.01;
+        std::vector<size_t> candidates;
+        _cityIndex.within(lat, lon, radius, candidates);
+        std::sort(candidates.begin(), candidates.end());
+
+        rels.reserve(candidates.size());
+        for (size_t i : candidates) {
+            double dist, azi1, azi2;
+            Seiscomp::Math::Geo::delazi(
+                lat, lon, _cities.lat[i], _cities.lon[i], &dist, &azi1, &azi2);
+            rels.push_back({ dist, azi2, i });
         }
-        return s;
+
+        std::stable_sort(rels.begin(), rels.end(),
+            [](const CityRel& x, const CityRel& y) { return x.distDeg < y.distDeg; });
+        if (rels.size() > count)
+            rels.resize(count);
+        return rels;
     }
 
     std::string nameByNearestCity(
-        double lat, double lon, const std::string& crustLabel, bool precise)
+        double lat, double lon, const std::string& crustLabel, bool precise) const
     {
-        double dist, azi;
         const std::string epiCountry = countryFor(lat, lon);
-        const CityD* city = nearestCity(lat, lon, 9999999, 0, _cities, &dist, &azi);
-        const CityRel cityRel = { dist, azi, city->name(), city->countryID() };
-        const Template& templ = selectTemplate(precise, epiCountry, cityRel.country);
+        const std::vector<CityRel> nearest = closestCities(lat, lon, 1);
+        if (nearest.empty())
+            throw Seiscomp::Core::GeneralException("no cities loaded");
+        const CityRel& cityRel = nearest.front();
+        const Template& templ
+            = selectTemplate(precise, epiCountry, _cities.countryOf(cityRel.city));
         return cityRelativeDescription(templ, cityRel, epiCountry, crustLabel, precise);
     }
 
-    std::string nearbyCitiesString(Event* event, size_t count = 4)
+    std::string nearbyCitiesString(double lat, double lon, size_t count = 4) const
     {
-        OriginPtr o = Origin::Find(event->preferredOriginID());
-        const double lat = o->latitude().value();
-        const double lon = o->longitude().value();
+        GA_ALLOC_SCOPE("eqnamer", "EQNamer::nearbyCitiesString");
         const std::string epiCountry = countryFor(lat, lon);
 
-        std::vector<CityRel> rels;
-        rels.reserve(_cities.size());
-
-        for (const CityD& city : _cities) {
-            double dist, azi1, azi2;
-            Seiscomp::Math::Geo::delazi(lat, lon, city.lat, city.lon, &dist, &azi1, &azi2);
-            rels.push_back({ dist, azi2, city.name(), city.countryID() });
-        }
-
-        if (count > rels.size())
-            count = rels.size();
-
-        std::partial_sort(rels.begin(), rels.begin() + count, rels.end(),
-            [](const CityRel& x, const CityRel& y) { return x.distDeg < y.distDeg; });
+        const std::vector<CityRel> rels = closestCities(lat, lon, count);
 
         std::string ret;
-        for (size_t i = 0; i < count; ++i) {
+        for (size_t i = 0; i < rels.size(); ++i) {
             ret += cityRelativeDescription(_nearbyPlaceTemplate, rels[i], epiCountry, "", true)
                 + "\n";
         }
@@ -314,6 +398,7 @@ protected:
 
     bool _setup(const Seiscomp::Config::Config& config)
     {
+        GA_TRACE_SCOPE("eqnamer", "EQNamer::_setup");
         std::string citiesPath;
         try {
             citiesPath
@@ -342,6 +427,11 @@ protected:
         }
 
         _homeCountry = getStringOrDefault(config, "eqnamer.homeCountry", "");
+        try {
+            _precompute = config.getBool("eqnamer.precompute");
+        } catch (...) {
+            _precompute = false;
+        }
         _nearbyPlaceTemplate = getStringsOrDefault(
             config, "eqnamer.nearbyPlaceTemplate", { "@dist@ km @dir@ of @poi@" });
 
@@ -363,49 +453,172 @@ protected:
             SEISCOMP_ERROR("EQNamer: Could not read cities XML from '%s'", citiesPath);
             return false;
         }
-        ar >> NAMED_OBJECT("City", _cities);
+        std::vector<CityD> cities;
+        ar >> NAMED_OBJECT("City", cities);
         ar.close();
-        SEISCOMP_INFO("EQNamer: loaded %d cities", (int)_cities.size());
 
-        const Regions* all_countries = Regions::load(countriesPath);
-        if (!all_countries || all_countries->featureSet.features().empty()) {
+        _cities.clear();
+        _cityIndex.clear();
+        _cityIndex.reserve(cities.size());
+        for (const CityD& city : cities) {
+            _cities.add(city);
+            _cityIndex.add(city.lat, city.lon);
+        }
+        _cityIndex.build();
+        SEISCOMP_INFO("EQNamer: loaded %d cities, %d distinct names and countries",
+            (int)_cities.size(), (int)_cities.strings.size());
+
+        // The feature sets only live until the indexes are built
+        Seiscomp::Geo::GeoFeatureSet countries;
+        if (!countries.readFile(countriesPath, nullptr) || countries.features().empty()) {
             SEISCOMP_ERROR("EQNamer: no country features loaded - is countriesPath set correctly?");
             return false;
         }
-        for (GeoFeature* f : all_countries->featureSet.features())
-            _countries.featureSet.addFeature(f);
-        const_cast<std::vector<GeoFeature*>&>(all_countries->featureSet.features()).clear();
-        SEISCOMP_INFO("EQNamer: loaded %d countries", (int)_countries.featureSet.features().size());
 
-        const Regions* all_regions = Regions::load(regionsPath);
-        if (!all_regions || all_regions->featureSet.features().empty()) {
+        _countryNames.clear();
+        for (const GeoFeature* f : countries.features())
+            _countryNames.push_back(getAttr(*f, "CNTRY_NAME"));
+        _countryIndex.build(countries.features());
+        SEISCOMP_INFO("EQNamer: loaded %d countries", (int)_countryNames.size());
+
+        Seiscomp::Geo::GeoFeatureSet regions;
+        if (!regions.readFile(regionsPath, nullptr) || regions.features().empty()) {
             SEISCOMP_ERROR("EQNamer: no features loaded - is regionsPath set correctly?");
             return false;
         }
 
-        for (GeoFeature* f : all_regions->featureSet.features()) {
+        std::vector<const GeoFeature*> staticRegions;
+        std::vector<const GeoFeature*> dynamicRegions;
+        _staticNames.clear();
+        _dynamicCrustLabels.clear();
+        for (const GeoFeature* f : regions.features()) {
             const auto& attrs = f->attributes();
             auto it = attrs.find("Dynamic");
             if (it != attrs.end()) {
-                if (it->second == "Dynamic")
-                    _dynamicRegions.featureSet.addFeature(f);
-                else
-                    _staticRegions.featureSet.addFeature(f);
+                if (it->second == "Dynamic") {
+                    dynamicRegions.push_back(f);
+                    _dynamicCrustLabels.push_back(crustTypeLabel(*f));
+                } else {
+                    staticRegions.push_back(f);
+                    _staticNames.push_back(getFeatureName(*f));
+                }
             }
         }
 
-        const_cast<std::vector<GeoFeature*>&>(all_regions->featureSet.features()).clear();
+        _staticIndex.build(staticRegions);
+        _dynamicIndex.build(dynamicRegions);
 
         SEISCOMP_INFO("EQNamer: loaded %d static regions, %d dynamic regions",
-            (int)_staticRegions.featureSet.features().size(),
-            (int)_dynamicRegions.featureSet.features().size());
+            (int)staticRegions.size(), (int)dynamicRegions.size());
+        SEISCOMP_INFO("EQNamer: packed polygons use %d kB",
+            (int)((_countryIndex.packedSize() + _staticIndex.packedSize()
+                      + _dynamicIndex.packedSize())
+                / 1024));
+
+        return true;
+    }
+
+    // Queues the name of an origin for computation on the worker thread
+    void precompute(const NamingInput& input)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto it = _precomputed.find(input.originID);
+        if (it != _precomputed.end() && it->second.input == input)
+            return;
+
+        if (it == _precomputed.end())
+            _precomputedOrder.push_back(input.originID);
+        _precomputed[input.originID] = { input, false, Naming() };
+
+        while (_precomputed.size() > MaxPrecomputed) {
+            _precomputed.erase(_precomputedOrder.front());
+            _precomputedOrder.pop_front();
+        }
+
+        _queue.push_back(input);
+        if (!_worker.joinable())
+            _worker = std::thread(&EQNamer::work, this);
+        _wake.notify_one();
+    }
+
+    // Returns the precomputed name of the origin if it is ready and was
+    // computed from the same input
+    bool takePrecomputed(const NamingInput& input, Naming& naming)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto it = _precomputed.find(input.originID);
+        if (it == _precomputed.end() || !it->second.ready || !(it->second.input == input)) {
+            ++_misses;
+            return false;
+        }
 
+        naming = it->second.naming;
+        ++_hits;
         return true;
     }
 
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            _wake.wait(lock, [this] { return _stopping || !_queue.empty(); });
+            if (_stopping)
+                return;
+
+            const NamingInput input = _queue.front();
+            _queue.pop_front();
+
+            auto it = _precomputed.find(input.originID);
+            if (it == _precomputed.end() || it->second.ready || !(it->second.input == input))
+                continue;
+
+            lock.unlock();
+            Naming naming;
+            bool ok = true;
+            try {
+                naming = computeNaming(input, "EQNamer::precompute", input.originID.c_str());
+            } catch (Seiscomp::Core::GeneralException& ex) {
+                SEISCOMP_WARNING("EQNamer: precomputing name of %s failed: %s",
+                    input.originID.c_str(), ex.what());
+                ok = false;
+            } catch (...) {
+                ok = false;
+            }
+            lock.lock();
+
+            // The entry may have been replaced or evicted in the meantime
+            it = _precomputed.find(input.originID);
+            if (it == _precomputed.end() || !(it->second.input == input))
+                continue;
+            if (!ok) {
+                _precomputed.erase(it);
+                continue;
+            }
+            it->second.naming = std::move(naming);
+            it->second.ready = true;
+        }
+    }
+
 public:
     EQNamer() { }
 
+    ~EQNamer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _wake.notify_all();
+        if (_worker.joinable())
+            _worker.join();
+
+        if (_hits + _misses > 0)
+            SEISCOMP_INFO("EQNamer: %d of %d names were precomputed", (int)_hits,
+                (int)(_hits + _misses));
+    }
+
     bool setup(const Seiscomp::Config::Config& config)
     {
         try {
@@ -421,6 +634,8 @@ public:
 
     bool _process(Event* event, bool isNewEvent, const Journal& journal)
     {
+        GA_TRACE_SCOPE("eqnamer", "EQNamer::_process");
+        GA_ALLOC_SCOPE("eqnamer", "EQNamer::_process");
         EventDescription* regionDesc = event->eventDescription(EventDescriptionIndex(REGION_NAME));
         if (regionDesc) {
             SEISCOMP_INFO("EQNamer::process(%s): existing region name is '%s'",
@@ -432,18 +647,26 @@ public:
             event->add(regionDesc);
         }
 
-        const std::string name = nameEvent(event);
+        OriginPtr o = Origin::Find(event->preferredOriginID());
+        if (!o)
+            throw Seiscomp::Core::GeneralException(
+                "preferred origin " + event->preferredOriginID() + " not found");
+
+        const NamingInput input = namingInput(o.get());
+        Naming naming;
+        if (_precompute && takePrecomputed(input, naming)) {
+            SEISCOMP_DEBUG("EQNamer::process(%s): using precomputed name of %s",
+                event->publicID().c_str(), input.originID.c_str());
+        } else {
+            naming = computeNaming(input, "EQNamer::process", event->publicID().c_str());
+        }
+
+        const std::string& name = naming.name;
         SEISCOMP_INFO(
             "EQNamer::process(%s): setting region name to '%s'", event->publicID().c_str(), name);
         regionDesc->setText(name);
 
-        bool reviewed = false;
-        try {
-            OriginPtr o = Origin::Find(event->preferredOriginID());
-            const auto status = o->evaluationStatus();
-            reviewed = status == REVIEWED || status == FINAL;
-        } catch (...) {
-        }
+        const bool reviewed = input.precise;
 
         Comment* nearbyPlaces = NULL;
         for (size_t i = 0; i < event->commentCount(); i++) {
@@ -455,7 +678,7 @@ public:
         }
 
         if (reviewed) {
-            const std::string nc = nearbyCitiesString(event);
+            const std::string& nc = naming.nearbyPlaces;
             if (!nearbyPlaces) {
                 SEISCOMP_INFO("EQNamer::process(%s): adding new nearby places:\n%s",
                     event->publicID().c_str(), nc);
@@ -504,7 +727,25 @@ public:
         }
     }
 
-    Magnitude* preferredMagnitude(const Origin* origin) { return nullptr; }
+    // scevent asks for the preferred magnitude of every new or updated origin
+    // before it updates the event. eqnamer does not select magnitudes but uses
+    // the call to start naming the origin on its worker thread, so that
+    // process() usually finds the name ready. scevent stops asking at the
+    // first processor that returns a magnitude, so eqnamer must be loaded
+    // before magselect for this to happen.
+    Magnitude* preferredMagnitude(const Origin* origin)
+    {
+        GA_ALLOC_SCOPE("eqnamer", "EQNamer::preferredMagnitude");
+        if (!_precompute || !origin)
+            return nullptr;
+
+        try {
+            precompute(namingInput(origin));
+        } catch (...) {
+            // Incomplete origin, process() names it synchronously
+        }
+        return nullptr;
+    }
 };
 
 REGISTER_EVENTPROCESSOR(EQNamer, "EQNAMER");
@@ -1,10 +1,5 @@
 #define SEISCOMP_COMPONENT MAGSELECT
 
-#include <seiscomp/core/version.h>
-#if SC_API_VERSION < SC_API_VERSION_CHECK(17, 3, 0)
-#  error "magselect requires SeisComP API >= 17.3.0 (SeisComP release >= 7.3.0)"
-#endif
-
 #include <seiscomp/core/exceptions.h>
 #include <seiscomp/core/plugin.h>
 #include <seiscomp/config/config.h>
@@ -13,9 +8,14 @@
 #include <seiscomp/datamodel/origin.h>
 #include <seiscomp/logging/log.h>
 #include <seiscomp/plugins/events/eventprocessor.h>
-#include <seiscomp/utils/leparser.h>
 
-#include <stdexcept>
+#include <ga/alloc/alloc.h>
+#include <ga/core/rules.h>
+#include <ga/trace/trace.h>
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
 #include <string>
 #include <vector>
 
@@ -27,63 +27,39 @@ ADD_SC_PLUGIN(
 namespace {
 
 /*
- * Evaluation context that exposes origin and reference-magnitude attributes
- * to LeParser V2 conditions.
- *
- * Available keys (double):
+ * Values of the rule condition keys for an origin (see GA::Core::Condition):
  *   mag / magnitude  — value of the reference magnitude type
  *   stations         — station count of the reference magnitude type
  *   depth            — origin depth in km
  *   lat / latitude   — origin latitude
  *   lon / longitude  — origin longitude
  *
- * Throws Core::ValueException when a key is valid but has no value set.
- * Throws std::runtime_error for unknown keys.
+ * Values the origin does not have, including a station count of 0, are left
+ * unset (NaN), which makes conditions that need them count as valueMissing.
  */
-class MagKeyValueContext : public Seiscomp::Utils::V2::LeKeyValueContext {
-    public:
-        MagKeyValueContext(const Seiscomp::DataModel::Origin *origin,
-                           const std::string &referenceType)
-            : _origin(origin), _refMag(nullptr) {
-            for ( size_t i = 0; i < origin->magnitudeCount(); ++i ) {
-                auto *m = origin->magnitude(i);
-                if ( m->type() == referenceType ) {
-                    _refMag = m;
-                    break;
-                }
-            }
-        }
-
-        double getDouble(std::string_view key) const override {
-            if ( key == "mag" || key == "magnitude" ) {
-                if ( !_refMag ) throw Seiscomp::Core::ValueException();
-                return _refMag->magnitude().value();
-            }
-            if ( key == "stations" ) {
-                if ( !_refMag ) throw Seiscomp::Core::ValueException();
-                if ( !_refMag->stationCount() ) throw Seiscomp::Core::ValueException();
-                return static_cast<double>(_refMag->stationCount());
-            }
-            if ( key == "depth" ) {
-                return _origin->depth().value();
-            }
-            if ( key == "lat" || key == "latitude" ) {
-                return _origin->latitude().value();
-            }
-            if ( key == "lon" || key == "longitude" ) {
-                return _origin->longitude().value();
-            }
-            throw std::runtime_error(std::string("unknown key: ") + std::string(key));
+GA::Core::ConditionValues conditionValues(const Seiscomp::DataModel::Origin *origin,
+                                          const std::string &referenceType) {
+    GA::Core::ConditionValues values;
+
+    for ( size_t i = 0; i < origin->magnitudeCount(); ++i ) {
+        const auto *m = origin->magnitude(i);
+        if ( m->type() != referenceType ) continue;
+
+        values.magnitude = m->magnitude().value();
+        try {
+            if ( m->stationCount() )
+                values.stations = static_cast<double>(m->stationCount());
         }
+        catch ( ... ) {}
+        break;
+    }
 
-        std::string getString(std::string_view key) const override {
-            throw std::runtime_error(std::string("unknown key: ") + std::string(key));
-        }
+    try { values.depth = origin->depth().value(); } catch ( ... ) {}
+    try { values.latitude = origin->latitude().value(); } catch ( ... ) {}
+    try { values.longitude = origin->longitude().value(); } catch ( ... ) {}
 
-    private:
-        const Seiscomp::DataModel::Origin    *_origin;
-        const Seiscomp::DataModel::Magnitude *_refMag;
-};
+    return values;
+}
 
 } // namespace
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -92,13 +68,14 @@ class MagKeyValueContext : public Seiscomp::Utils::V2::LeKeyValueContext {
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 class MagSelectProcessor : public Seiscomp::Client::EventProcessor {
 
-    struct SelectorRule {
-        Seiscomp::Utils::V2::LeExpressionPtr expression;
-        std::string                           magnitudeType;
-    };
+    using Clock = std::chrono::steady_clock;
 
     public:
 
+        ~MagSelectProcessor() override {
+            if ( _calls ) logStatistics();
+        }
+
         bool setup(const Seiscomp::Config::Config &config) override {
             try {
                 _referenceType = config.getString("magselect.referenceType");
@@ -117,10 +94,11 @@ class MagSelectProcessor : public Seiscomp::Client::EventProcessor {
                 return false;
             }
 
-            Seiscomp::Utils::V2::LeKeyValueFactory factory;
-            auto symbols = Seiscomp::Utils::V2::LeParser::DefaultSymbols();
-            symbols.reserved = Seiscomp::Utils::V2::LeKeyValueFactory::Reserved();
-            Seiscomp::Utils::V2::LeParser parser(&factory, &symbols);
+            // Interval in seconds between statistics reports, 0 disables them.
+            try {
+                _statsInterval = config.getDouble("magselect.statsInterval");
+            }
+            catch ( ... ) {}
 
             for ( const auto &name : ruleNames ) {
                 const std::string base = "magselect.rules." + name;
@@ -145,9 +123,8 @@ class MagSelectProcessor : public Seiscomp::Client::EventProcessor {
                     continue;
                 }
 
-                Seiscomp::Utils::V2::LeExpression *expr = nullptr;
                 try {
-                    expr = parser.parse(condStr);
+                    _rules.push_back({ name, GA::Core::Condition(condStr), magType, {} });
                 }
                 catch ( const std::exception &e ) {
                     SEISCOMP_WARNING("magselect: rule '%s' invalid condition '%s': %s",
@@ -155,17 +132,14 @@ class MagSelectProcessor : public Seiscomp::Client::EventProcessor {
                     continue;
                 }
 
-                SelectorRule rule;
-                rule.expression = expr;
-                rule.magnitudeType = magType;
-                _rules.emplace_back(std::move(rule));
-
                 SEISCOMP_INFO("magselect: rule '%s': [%s] -> %s",
                               name.c_str(), condStr.c_str(), magType.c_str());
             }
 
             SEISCOMP_INFO("magselect: %d rule(s) loaded, reference type: %s",
                           static_cast<int>(_rules.size()), _referenceType.c_str());
+
+            _lastReport = Clock::now();
             return !_rules.empty();
         }
 
@@ -178,43 +152,23 @@ class MagSelectProcessor : public Seiscomp::Client::EventProcessor {
          */
         Seiscomp::DataModel::Magnitude *preferredMagnitude(
                 const Seiscomp::DataModel::Origin *origin) override {
+            GA_TRACE_SCOPE("magselect", "MagSelectProcessor::preferredMagnitude");
+            GA_ALLOC_SCOPE("magselect", "MagSelectProcessor::preferredMagnitude");
             if ( _rules.empty() || !origin ) return nullptr;
 
-            MagKeyValueContext ctx(origin, _referenceType);
-
-            for ( const auto &rule : _rules ) {
-                if ( !rule.expression ) continue;
-
-                try {
-                    if ( !rule.expression->eval(&ctx) ) continue;
-                }
-                catch ( const Seiscomp::Core::ValueException & ) {
-                    // Reference magnitude or station count not yet available
-                    continue;
-                }
-                catch ( const std::exception &e ) {
-                    SEISCOMP_WARNING("magselect: rule evaluation error for origin %s: %s",
-                                     origin->publicID().c_str(), e.what());
-                    continue;
-                }
+            const auto start = Clock::now();
+            Seiscomp::DataModel::Magnitude *mag = select(origin);
+            const auto end = Clock::now();
 
-                for ( size_t i = 0; i < origin->magnitudeCount(); ++i ) {
-                    auto *mag = origin->magnitude(i);
-                    if ( mag->type() == rule.magnitudeType ) {
-                        SEISCOMP_DEBUG("magselect: selected %s for origin %s",
-                                       rule.magnitudeType.c_str(),
-                                       origin->publicID().c_str());
-                        return mag;
-                    }
-                }
+            ++_calls;
+            _evaluationTime += end - start;
 
-                SEISCOMP_WARNING(
-                    "magselect: rule matched but type '%s' not found on origin %s — "
-                    "trying next rule",
-                    rule.magnitudeType.c_str(), origin->publicID().c_str());
+            if ( _statsInterval > 0
+              && std::chrono::duration<double>(end - _lastReport).count() >= _statsInterval ) {
+                logStatistics();
             }
 
-            return nullptr;
+            return mag;
         }
 
         bool process(Seiscomp::DataModel::Event *, bool,
@@ -222,9 +176,73 @@ class MagSelectProcessor : public Seiscomp::Client::EventProcessor {
             return false;
         }
 
+    private:
+        Seiscomp::DataModel::Magnitude *select(const Seiscomp::DataModel::Origin *origin) {
+            Seiscomp::DataModel::Magnitude *selected = nullptr;
+
+            const GA::Core::Rule *rule = GA::Core::selectRule(
+                _rules, conditionValues(origin, _referenceType),
+                [&](const std::string &type) {
+                    for ( size_t i = 0; i < origin->magnitudeCount(); ++i ) {
+                        auto *mag = origin->magnitude(i);
+                        if ( mag->type() == type ) {
+                            selected = mag;
+                            return true;
+                        }
+                    }
+
+                    SEISCOMP_WARNING(
+                        "magselect: rule matched but type '%s' not found on origin %s — "
+                        "trying next rule",
+                        type.c_str(), origin->publicID().c_str());
+                    return false;
+                });
+
+            if ( rule ) {
+                SEISCOMP_DEBUG("magselect: selected %s for origin %s",
+                               rule->magnitudeType.c_str(), origin->publicID().c_str());
+            }
+
+            return selected;
+        }
+
+        /*
+         * Logs the per-rule counters and the cumulative evaluation time
+         * collected since the last report, then resets them.
+         */
+        void logStatistics() {
+            const double totalMs =
+                std::chrono::duration<double, std::milli>(_evaluationTime).count();
+
+            SEISCOMP_INFO("magselect: %llu origin(s) evaluated in %.3f ms (%.1f us/origin)",
+                          static_cast<unsigned long long>(_calls), totalMs,
+                          _calls ? totalMs * 1000.0 / _calls : 0.0);
+
+            for ( auto &rule : _rules ) {
+                const GA::Core::RuleStats &st = rule.stats;
+                SEISCOMP_INFO("magselect: rule '%s' -> %s: evaluated=%llu matched=%llu "
+                              "typeMissing=%llu valueMissing=%llu",
+                              rule.name.c_str(), rule.magnitudeType.c_str(),
+                              static_cast<unsigned long long>(st.evaluated),
+                              static_cast<unsigned long long>(st.matched),
+                              static_cast<unsigned long long>(st.typeMissing),
+                              static_cast<unsigned long long>(st.valueMissing));
+                rule.stats = GA::Core::RuleStats();
+            }
+
+            _calls = 0;
+            _evaluationTime = Clock::duration::zero();
+            _lastReport = Clock::now();
+        }
+
     private:
         std::string               _referenceType;
-        std::vector<SelectorRule> _rules;
+        std::vector<GA::Core::Rule> _rules;
+
+        double                    _statsInterval{3600};
+        uint64_t                  _calls{0};
+        Clock::duration           _evaluationTime{Clock::duration::zero()};
+        Clock::time_point         _lastReport;
 };
 
 REGISTER_EVENTPROCESSOR(MagSelectProcessor, "MagSelect");
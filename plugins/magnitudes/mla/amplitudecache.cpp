@@ -0,0 +1,74 @@
+#define SEISCOMP_COMPONENT MLa
+
+#include "amplitudecache.h"
+
+#include <seiscomp/logging/log.h>
+
+AmplitudeCache &AmplitudeCache::Instance()
+{
+    static AmplitudeCache cache;
+    return cache;
+}
+
+bool AmplitudeCache::lookup(const std::string &key, Entry *entry)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto it = _index.find(key);
+    const bool hit = it != _index.end();
+    if ( hit ) {
+        _entries.splice(_entries.begin(), _entries, it->second);
+        *entry = it->second->second;
+        ++_stats.hits;
+    }
+    else
+        ++_stats.misses;
+
+    if ( (_stats.hits + _stats.misses) % 100 == 0 )
+        report();
+
+    return hit;
+}
+
+void AmplitudeCache::store(const std::string &key, const Result &result, size_t capacity)
+{
+    if ( capacity == 0 )
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    Entry entry{result, result.record};
+    auto it = _index.find(key);
+    if ( it != _index.end() ) {
+        it->second->second = entry;
+        _entries.splice(_entries.begin(), _entries, it->second);
+        return;
+    }
+
+    _entries.emplace_front(key, entry);
+    _index[key] = _entries.begin();
+
+    while ( _entries.size() > capacity ) {
+        _index.erase(_entries.back().first);
+        _entries.pop_back();
+        ++_stats.evictions;
+    }
+}
+
+AmplitudeCache::Statistics AmplitudeCache::statistics() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+void AmplitudeCache::report() const
+{
+    const uint64_t lookups = _stats.hits + _stats.misses;
+    SEISCOMP_INFO("MLa amplitude cache: %llu lookups, %llu hits (%.1f%%), "
+                  "%llu entries, %llu evictions",
+                  static_cast<unsigned long long>(lookups),
+                  static_cast<unsigned long long>(_stats.hits),
+                  lookups ? 100.0 * _stats.hits / lookups : 0.0,
+                  static_cast<unsigned long long>(_entries.size()),
+                  static_cast<unsigned long long>(_stats.evictions));
+}
@@ -0,0 +1,71 @@
+/*
+ * File:   amplitudecache.h
+ */
+
+#ifndef __MLA_AMPLITUDECACHE_H__
+#define __MLA_AMPLITUDECACHE_H__
+
+#include <seiscomp/processing/amplitudeprocessor.h>
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+Process-wide, bounded cache of final MLa amplitudes.
+
+When an origin is relocated or another origin is associated with the event,
+scamp sets up amplitude processors again for picks it already measured. With
+the same stream, pick time, windows and processing configuration (see
+Amplitude_MLA::cacheKey()) the result cannot differ as long as the waveforms
+of the stream have not changed, which holds for the record-by-record
+real-time feed. A processor that finds its key here
+publishes the stored amplitude instead of processing waveforms.
+
+The least recently used entries are dropped beyond the capacity. Hits and
+misses are logged every 100 lookups.
+*/
+class AmplitudeCache
+{
+public:
+    typedef Seiscomp::Processing::AmplitudeProcessor::Result Result;
+
+    struct Entry {
+        Result result;
+        // Keeps the record of result alive.
+        Seiscomp::RecordCPtr record;
+    };
+
+    struct Statistics {
+        uint64_t hits{0};
+        uint64_t misses{0};
+        uint64_t evictions{0};
+    };
+
+    static AmplitudeCache &Instance();
+
+    // Copies the entry for key into entry, if there is one.
+    bool lookup(const std::string &key, Entry *entry);
+
+    // Stores a final amplitude, evicting the oldest entries beyond capacity.
+    void store(const std::string &key, const Result &result, size_t capacity);
+
+    Statistics statistics() const;
+
+private:
+    AmplitudeCache() = default;
+
+    void report() const;
+
+    typedef std::list<std::pair<std::string, Entry>> Entries;
+
+    mutable std::mutex _mutex;
+    // Most recently used first
+    Entries _entries;
+    std::unordered_map<std::string, Entries::iterator> _index;
+    Statistics _stats;
+};
+
+#endif /* __MLA_AMPLITUDECACHE_H__ */
@@ -0,0 +1,200 @@
+#define SEISCOMP_COMPONENT MLa
+
+#include "amplitudeexecutor.h"
+
+#include <seiscomp/logging/log.h>
+
+#include <algorithm>
+#include <exception>
+#include <vector>
+
+namespace {
+
+void runTask(const std::function<void()> &task)
+{
+    try {
+        task();
+    }
+    catch ( const std::exception &e ) {
+        SEISCOMP_ERROR("MLa amplitude task failed: %s", e.what());
+    }
+    catch ( ... ) {
+        SEISCOMP_ERROR("MLa amplitude task failed with an unknown exception");
+    }
+}
+
+double seconds(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+}
+
+AmplitudeExecutor &AmplitudeExecutor::Instance()
+{
+    static AmplitudeExecutor executor;
+    return executor;
+}
+
+void AmplitudeExecutor::configure(size_t threads, size_t queueSize)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if ( _pool || threads == 0 )
+        return;
+
+    _pool.reset(new WorkerPool(threads));
+    _queueSize = std::max<size_t>(queueSize, 1);
+    SEISCOMP_INFO("MLa amplitude executor: %d threads, queue size %d",
+                  static_cast<int>(threads), static_cast<int>(_queueSize));
+}
+
+AmplitudeExecutor::TicketPtr AmplitudeExecutor::submit(const std::string &stream,
+                                                       std::function<void()> task,
+                                                       std::function<void()> complete)
+{
+    TicketPtr ticket = std::make_shared<Ticket>();
+    ticket->stream = stream;
+    ticket->complete = std::move(complete);
+
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _order[stream].push_back(ticket);
+        ++_stats.submitted;
+        if ( _pool && _inFlight < _queueSize ) {
+            ++_inFlight;
+            _stats.peakInFlight = std::max(_stats.peakInFlight, _inFlight);
+            queued = true;
+        }
+        else
+            ++_stats.inlined;
+    }
+
+    const Clock::time_point submitted = Clock::now();
+    if ( !queued ) {
+        runTask(task);
+        std::lock_guard<std::mutex> lock(_mutex);
+        finished(*ticket, Clock::duration::zero(), Clock::now() - submitted);
+        return ticket;
+    }
+
+    // The ticket is shared with the worker so that it outlives a processor
+    // destroyed while its task is still queued.
+    _pool->submit([this, ticket, task, submitted]() {
+        const Clock::time_point started = Clock::now();
+        runTask(task);
+        const Clock::time_point stopped = Clock::now();
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            --_inFlight;
+            finished(*ticket, started - submitted, stopped - started);
+        }
+        _done.notify_all();
+    });
+
+    return ticket;
+}
+
+bool AmplitudeExecutor::ready(const Ticket &ticket)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if ( !ticket.done )
+        return false;
+
+    auto it = _order.find(ticket.stream);
+    return it != _order.end() && !it->second.empty() && it->second.front().get() == &ticket;
+}
+
+void AmplitudeExecutor::runCompleted()
+{
+    if ( _completing )
+        return;
+    _completing = true;
+
+    // A completion releases its ticket, which may make the next one of
+    // the stream ready, so collect again until none is left.
+    std::vector<TicketPtr> ready;
+    while ( true ) {
+        ready.clear();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for ( const auto &item : _order ) {
+                const TicketPtr &front = item.second.front();
+                if ( front->done && front->complete )
+                    ready.push_back(front);
+            }
+        }
+        if ( ready.empty() )
+            break;
+
+        for ( const TicketPtr &ticket : ready ) {
+            // Taken out so that it runs once. An earlier completion may
+            // have destroyed its processor, which releases the ticket and
+            // clears the completion.
+            std::function<void()> complete;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                complete.swap(ticket->complete);
+            }
+            if ( complete )
+                runTask(complete);
+        }
+    }
+
+    _completing = false;
+}
+
+void AmplitudeExecutor::wait(const Ticket &ticket)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [&ticket]() { return ticket.done; });
+}
+
+void AmplitudeExecutor::release(const Ticket &ticket)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _order.find(ticket.stream);
+    if ( it == _order.end() )
+        return;
+
+    auto &tickets = it->second;
+    for ( auto t = tickets.begin(); t != tickets.end(); ++t ) {
+        if ( t->get() == &ticket ) {
+            (*t)->complete = nullptr;
+            tickets.erase(t);
+            break;
+        }
+    }
+    if ( tickets.empty() )
+        _order.erase(it);
+}
+
+AmplitudeExecutor::Statistics AmplitudeExecutor::statistics() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+void AmplitudeExecutor::finished(Ticket &ticket, Clock::duration wait, Clock::duration run)
+{
+    ticket.done = true;
+    ++_stats.completed;
+    _stats.waitTime += seconds(wait);
+    _stats.runTime += seconds(run);
+
+    if ( _stats.completed % 100 == 0 )
+        report();
+}
+
+void AmplitudeExecutor::report() const
+{
+    const uint64_t queued = _stats.submitted - _stats.inlined;
+    SEISCOMP_INFO("MLa amplitude executor: %llu submitted, %llu inline, "
+                  "%d in flight (peak %d), mean wait %.1f ms, mean run %.1f ms",
+                  static_cast<unsigned long long>(_stats.submitted),
+                  static_cast<unsigned long long>(_stats.inlined),
+                  static_cast<int>(_inFlight), static_cast<int>(_stats.peakInFlight),
+                  queued ? 1000.0 * _stats.waitTime / queued : 0.0,
+                  _stats.completed ? 1000.0 * _stats.runTime / _stats.completed : 0.0);
+}
@@ -0,0 +1,114 @@
+/*
+ * File:   amplitudeexecutor.h
+ */
+
+#ifndef __MLA_AMPLITUDEEXECUTOR_H__
+#define __MLA_AMPLITUDEEXECUTOR_H__
+
+#include "workerpool.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+Process-wide, bounded worker pool for the asynchronous MLa amplitude mode
+(amplitudes.<type>.async.*).
+
+An amplitude processor submits the filtering of its completed window as a
+task and gets a ticket. Tickets are ordered per stream in submission order:
+a ticket is ready once its task has finished and all earlier tickets of the
+same stream have been released, so the processors of a stream publish in the
+order of their picks no matter which worker finishes first.
+
+At most queueSize tasks are queued or running. Beyond that a task runs on the
+submitting thread (backpressure). Submitted, inline, peak in flight and the
+mean queue wait and run times are logged every 100 tasks.
+
+Each ticket carries a completion, which publishes the amplitude. It is not
+run by the worker but by runCompleted() on the feeding thread, which every
+processor calls when it is fed or closed. So an amplitude is published with
+the next record of any stream, not only of its own, and with close() at the
+end of the data. Processors using the executor must be fed from one thread.
+*/
+class AmplitudeExecutor
+{
+public:
+    struct Ticket {
+        std::string stream;
+        // Set when the task has finished, guarded by the executor.
+        bool done{false};
+        // Run once by runCompleted() when the ticket is ready; cleared by
+        // release().
+        std::function<void()> complete;
+    };
+
+    typedef std::shared_ptr<Ticket> TicketPtr;
+
+    struct Statistics {
+        uint64_t submitted{0};
+        // Run on the submitting thread because the queue was full
+        uint64_t inlined{0};
+        uint64_t completed{0};
+        size_t peakInFlight{0};
+        // Accumulated seconds between submission and start, and running
+        double waitTime{0};
+        double runTime{0};
+    };
+
+    static AmplitudeExecutor &Instance();
+
+    // Starts the workers on first use; later calls keep the first
+    // configuration.
+    void configure(size_t threads, size_t queueSize);
+
+    // Runs task on a worker, or on the calling thread if the queue is full,
+    // and returns its ticket. Exceptions of the task are logged. complete is
+    // called by runCompleted(), unless the ticket is released before.
+    TicketPtr submit(const std::string &stream, std::function<void()> task,
+                     std::function<void()> complete);
+
+    // Runs the completions of all ready tickets on the calling thread, in
+    // the order of their streams. Does nothing if called from a completion.
+    void runCompleted();
+
+    // Whether the task of ticket finished and it is the stream's turn.
+    bool ready(const Ticket &ticket);
+
+    // Blocks until the task of ticket has finished.
+    void wait(const Ticket &ticket);
+
+    // Removes ticket from the order of its stream, after publishing or when
+    // the processor is destroyed.
+    void release(const Ticket &ticket);
+
+    Statistics statistics() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    AmplitudeExecutor() = default;
+
+    // Marks ticket done and accounts for it, with _mutex held.
+    void finished(Ticket &ticket, Clock::duration wait, Clock::duration run);
+    void report() const;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _done;
+    std::unique_ptr<WorkerPool> _pool;
+    size_t _queueSize{0};
+    size_t _inFlight{0};
+    std::unordered_map<std::string, std::deque<TicketPtr>> _order;
+    Statistics _stats;
+    // Set while runCompleted() runs completions, only used by the feeding
+    // thread.
+    bool _completing{false};
+};
+
+#endif /* __MLA_AMPLITUDEEXECUTOR_H__ */
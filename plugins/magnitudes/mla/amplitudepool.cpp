@@ -0,0 +1,122 @@
+#define SEISCOMP_COMPONENT MLa
+
+#include "amplitudepool.h"
+
+#include <seiscomp/logging/log.h>
+
+#include <algorithm>
+
+AmplitudePool &AmplitudePool::Instance()
+{
+    static AmplitudePool pool;
+    return pool;
+}
+
+AmplitudePool::~AmplitudePool()
+{
+    for ( auto &item : _streams ) {
+        for ( auto &pooled : item.second.filters )
+            delete pooled.filter;
+    }
+}
+
+void AmplitudePool::setCapacity(const std::string &stream, size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _streams[stream].capacity = capacity;
+}
+
+void AmplitudePool::acquireBuffer(const std::string &stream, std::vector<double> &buffer)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.bufferRequests;
+
+    auto it = _streams.find(stream);
+    if ( it == _streams.end() || it->second.buffers.empty() ) {
+        ++_stats.bufferAllocations;
+        return;
+    }
+
+    buffer.swap(it->second.buffers.back());
+    it->second.buffers.pop_back();
+    buffer.clear();
+}
+
+void AmplitudePool::releaseBuffer(const std::string &stream, std::vector<double> &buffer)
+{
+    if ( buffer.capacity() == 0 )
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    StreamPool &pool = _streams[stream];
+    if ( pool.buffers.size() >= pool.capacity )
+        return;
+
+    pool.buffers.emplace_back();
+    pool.buffers.back().swap(buffer);
+}
+
+AmplitudePool::Filter *AmplitudePool::acquireFilter(const std::string &stream,
+                                                    const std::string &config)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.filterRequests;
+
+    auto it = _streams.find(stream);
+    if ( it == _streams.end() )
+        return nullptr;
+
+    for ( const auto &f : it->second.filters ) {
+        if ( f.config == config )
+            return f.filter->clone();
+    }
+
+    return nullptr;
+}
+
+void AmplitudePool::releaseFilter(const std::string &stream, const std::string &config,
+                                  Filter *filter)
+{
+    if ( !filter )
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        StreamPool &pool = _streams[stream];
+        const bool known = std::any_of(pool.filters.begin(), pool.filters.end(),
+                                       [&config](const PooledFilter &f) {
+                                           return f.config == config;
+                                       });
+        if ( !known && pool.filters.size() < pool.capacity ) {
+            pool.filters.push_back({ config, filter });
+            return;
+        }
+    }
+
+    delete filter;
+}
+
+void AmplitudePool::countFilterAllocation()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.filterAllocations;
+}
+
+void AmplitudePool::countAmplitude()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if ( ++_stats.amplitudes % 1000 != 0 )
+        return;
+
+    const double n = double(_stats.amplitudes);
+    SEISCOMP_DEBUG("Amplitude pool: %llu amplitudes, %.3f buffer and %.3f filter "
+                   "allocations per amplitude",
+                   static_cast<unsigned long long>(_stats.amplitudes),
+                   _stats.bufferAllocations / n, _stats.filterAllocations / n);
+}
+
+AmplitudePool::Statistics AmplitudePool::statistics() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
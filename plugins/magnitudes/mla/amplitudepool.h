@@ -0,0 +1,90 @@
+/*
+ * File:   amplitudepool.h
+ */
+
+#ifndef __MLA_AMPLITUDEPOOL_H__
+#define __MLA_AMPLITUDEPOOL_H__
+
+#include <seiscomp/math/filter.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+Process-wide pool of the per-stream resources of MLa amplitude processors.
+
+scamp creates a new amplitude processor per stream and pick and destroys it
+once the amplitude is emitted. Instead of freeing its sample buffer and filter
+chain, a processor hands them back to the pool on destruction. The next
+processor for the same stream takes the buffer over with its capacity, and
+gets a clone() of the chain instead of parsing and building it from the filter
+string again.
+
+The chain itself is never handed out again: it carries the state of the
+previous pick, and SeisComP's filters keep their state when
+setSamplingFrequency() is called with an unchanged rate. A clone starts from
+a fresh state, like a newly built chain.
+*/
+class AmplitudePool
+{
+public:
+    typedef Seiscomp::Math::Filtering::InPlaceFilter<double> Filter;
+
+    struct Statistics {
+        uint64_t amplitudes{0};        // amplitudes computed
+        uint64_t bufferRequests{0};    // sample buffers handed out
+        uint64_t bufferAllocations{0}; // ... of which had to be allocated
+        uint64_t filterRequests{0};    // filter chains handed out
+        uint64_t filterAllocations{0}; // ... of which had to be built from
+                                       // the filter string
+    };
+
+    static AmplitudePool &Instance();
+
+    // Maximum number of idle buffers and filters kept for the stream, 4
+    // unless set. Lowering it does not drop what is pooled already.
+    void setCapacity(const std::string &stream, size_t capacity);
+
+    // Moves a pooled buffer for the stream into buffer (cleared, with its
+    // capacity retained). Leaves buffer untouched if none is available.
+    void acquireBuffer(const std::string &stream, std::vector<double> &buffer);
+    void releaseBuffer(const std::string &stream, std::vector<double> &buffer);
+
+    // Returns a fresh copy of a chain released with the same configuration,
+    // or nullptr. Ownership passes to the caller.
+    Filter *acquireFilter(const std::string &stream, const std::string &config);
+    // Takes ownership of filter and keeps it as the template of its
+    // configuration; deletes it if there is one already or the stream's pool
+    // is full.
+    void releaseFilter(const std::string &stream, const std::string &config, Filter *filter);
+
+    // Counts a newly built filter chain against filterAllocations.
+    void countFilterAllocation();
+    void countAmplitude();
+
+    Statistics statistics() const;
+
+private:
+    AmplitudePool() = default;
+    ~AmplitudePool();
+
+    struct PooledFilter {
+        std::string config;
+        Filter *filter;
+    };
+
+    struct StreamPool {
+        std::vector<std::vector<double>> buffers;
+        std::vector<PooledFilter> filters;
+        size_t capacity{4};
+    };
+
+    mutable std::mutex _mutex;
+    std::map<std::string, StreamPool> _streams;
+    Statistics _stats;
+};
+
+#endif /* __MLA_AMPLITUDEPOOL_H__ */
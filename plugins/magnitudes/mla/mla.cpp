@@ -1,15 +1,50 @@
 #define SEISCOMP_COMPONENT MLa
 
 #include "mla.h"
+#include "amplitudecache.h"
+#include "amplitudeexecutor.h"
+#include "amplitudepool.h"
+#include "prescreen.h"
+#include "workerpool.h"
 
+#include <ga/alloc/alloc.h>
+#include <ga/core/mla.h>
+#include <ga/trace/trace.h>
+
+#include <seiscomp/core/genericrecord.h>
+#include <seiscomp/core/strings.h>
+#include <seiscomp/datamodel/magnitude.h>
 #include <seiscomp/logging/log.h>
 #include <seiscomp/geo/feature.h>
+#include <seiscomp/math/filter/chainfilter.h>
+#include <seiscomp/math/filter/seismometers.h>
 #include <seiscomp/math/geo.h>
 
+#include <algorithm>
+#include <mutex>
 #include <vector>
 #include <string>
 #include <math.h>
 
+namespace {
+
+// Returns the samples of array as doubles, converting into converted if needed.
+const Seiscomp::DoubleArray *asDouble(const Seiscomp::Array *array,
+                                      Seiscomp::DoubleArrayPtr &converted)
+{
+    if ( !array )
+        return nullptr;
+
+    const Seiscomp::DoubleArray *data = Seiscomp::DoubleArray::ConstCast(array);
+    if ( !data ) {
+        converted = Seiscomp::DoubleArray::Cast(array->copy(Seiscomp::Array::DOUBLE));
+        data = converted.get();
+    }
+    return data;
+}
+
+}
+
 /*
 Maps the name of a region to the member function which is used to
 calculate the magnitude for that region.
@@ -39,6 +74,21 @@ Amplitude_MLA::Amplitude_MLA(const std::string& type)
     this->_type = type;
 }
 
+Amplitude_MLA::~Amplitude_MLA()
+{
+    abandonAsync();
+
+    if ( !_pooling )
+        return;
+
+    AmplitudePool &pool = AmplitudePool::Instance();
+    if ( _stream.filter && !_filterConfig.empty() ) {
+        pool.releaseFilter(_streamKey, _filterConfig, _stream.filter);
+        _stream.filter = nullptr;
+    }
+    pool.releaseBuffer(_streamKey, _data.impl());
+}
+
 bool Amplitude_MLA::setup(const Seiscomp::Processing::Settings &settings)
 {
     setDefaultConfiguration();
@@ -66,9 +116,581 @@ bool Amplitude_MLA::setup(const Seiscomp::Processing::Settings &settings)
     if ( settings.getValue(maxDist, "amplitudes." + _type + ".maxDist") ) {
         setMaxDist(maxDist);
     }
+
+    _streamKey = settings.networkCode + "." + settings.stationCode + "."
+               + settings.locationCode + "." + settings.channelCode + "." + _type;
+
+    // Only set by the caller through setExternalFilter()
+    _externalFilter = false;
+
+    _pooling = false;
+    settings.getValue(_pooling, "amplitudes." + _type + ".pooling");
+    if ( _pooling ) {
+        int capacity;
+        if ( settings.getValue(capacity, "amplitudes." + _type + ".poolCapacity") )
+            AmplitudePool::Instance().setCapacity(_streamKey, std::max(capacity, 0));
+        AmplitudePool::Instance().acquireBuffer(_streamKey, _data.impl());
+    }
+
+    _decimationRate = 0;
+    _decimator.reset();
+    settings.getValue(_decimationRate, "amplitudes." + _type + ".decimationRate");
+
+    const std::string gaps = "amplitudes." + _type + ".gaps.";
+    _gaps = Gaps();
+    settings.getValue(_gaps.maxGap, gaps + "maxGap");
+    settings.getValue(_gaps.reorderTime, gaps + "reorderTime");
+    std::string fill;
+    if ( settings.getValue(fill, gaps + "fill") ) {
+        if ( fill == "zero" )
+            _gaps.interpolate = false;
+        else if ( fill != "linear" ) {
+            SEISCOMP_WARNING("%s: invalid gap fill '%s', expected linear or zero",
+                             _type.c_str(), fill.c_str());
+            return false;
+        }
+    }
+    _held.clear();
+    _nextStart = Seiscomp::Core::Time();
+    _gapRate = 0;
+
+    _cacheSize = 0;
+    _cacheChecked = false;
+    settings.getValue(_cacheSize, "amplitudes." + _type + ".cacheSize");
+
+    const std::string prescreen = "amplitudes." + _type + ".prescreen.";
+    _prescreen = PreScreen::Config();
+    settings.getValue(_prescreen.enabled, prescreen + "enable");
+    settings.getValue(_prescreen.magnitudeType, prescreen + "magnitudeType");
+    settings.getValue(_prescreen.minimumSNR, prescreen + "minSNR");
+    settings.getValue(_prescreen.margin, prescreen + "margin");
+    settings.getValue(_prescreen.auditInterval, prescreen + "auditInterval");
+    settings.getValue(_prescreen.maxAge, prescreen + "maxAge");
+
+    const std::string provisional = "amplitudes." + _type + ".provisional.";
+    _provisional = Provisional();
+    _provisionalState = ProvisionalState();
+    settings.getValue(_provisional.enabled, provisional + "enable");
+    settings.getValue(_provisional.fraction, provisional + "fraction");
+    settings.getValue(_provisional.stableTime, provisional + "stableTime");
+
+    const std::string adaptive = "amplitudes." + _type + ".adaptiveWindow.";
+    _adaptive = AdaptiveWindow();
+    _envelope = Envelope();
+    settings.getValue(_adaptive.enabled, adaptive + "enable");
+    settings.getValue(_adaptive.envelopeLength, adaptive + "envelopeLength");
+    settings.getValue(_adaptive.ratio, adaptive + "ratio");
+    settings.getValue(_adaptive.decayTime, adaptive + "decayTime");
+    settings.getValue(_adaptive.pVelocity, adaptive + "pVelocity");
+    settings.getValue(_adaptive.sVelocity, adaptive + "sVelocity");
+    if ( _adaptive.enabled
+      && (_adaptive.sVelocity <= 0 || _adaptive.pVelocity <= _adaptive.sVelocity) ) {
+        SEISCOMP_ERROR("%s: adaptiveWindow.pVelocity must exceed sVelocity > 0",
+                       _type.c_str());
+        return false;
+    }
+
+    const std::string async = "amplitudes." + _type + ".async.";
+    int threads = 0, queueSize = 64;
+    settings.getValue(threads, async + "threads");
+    settings.getValue(queueSize, async + "queueSize");
+    _async = threads > 0;
+    _asyncFiltered = false;
+    if ( _async ) {
+        // Both need the filtered samples while the window fills.
+        if ( _provisional.enabled || _adaptive.enabled ) {
+            SEISCOMP_WARNING("%s: provisional amplitudes and the adaptive window "
+                             "are not available in asynchronous mode",
+                             _type.c_str());
+            _provisional.enabled = false;
+            _adaptive.enabled = false;
+        }
+        AmplitudeExecutor::Instance().configure(static_cast<size_t>(threads),
+                                                static_cast<size_t>(std::max(queueSize, 1)));
+    }
+
+    _singlePrecision = false;
+    _floatFilter.reset();
+    _floatData.clear();
+    settings.getValue(_singlePrecision, "amplitudes." + _type + ".singlePrecision");
+    if ( _singlePrecision ) {
+        // All of them need the filtered window in double before it is
+        // complete. With responses the Wood-Anderson simulation is applied
+        // to the spectrum of the double window, not by the filter chain.
+        bool responses = false;
+        settings.getValue(responses, "amplitudes." + _type + ".enableResponses");
+        if ( _async || _provisional.enabled || _adaptive.enabled || responses ) {
+            SEISCOMP_WARNING("%s: single precision is not available with responses, "
+                             "provisional amplitudes, the adaptive window or in "
+                             "asynchronous mode, using double precision",
+                             _type.c_str());
+            _singlePrecision = false;
+        }
+    }
+
     return true;
 }
 
+void Amplitude_MLA::setEnvironment(const Seiscomp::DataModel::Origin *hypocenter,
+                                   const Seiscomp::DataModel::SensorLocation *receiver,
+                                   const Seiscomp::DataModel::Pick *pick)
+{
+    Seiscomp::Processing::AmplitudeProcessor_MLv::setEnvironment(hypocenter, receiver, pick);
+
+    _hypocentralDistance = -1;
+    if ( hypocenter && receiver ) {
+        try {
+            double delta, az, baz;
+            Seiscomp::Math::Geo::delazi(hypocenter->latitude().value(),
+                                        hypocenter->longitude().value(),
+                                        receiver->latitude(), receiver->longitude(),
+                                        &delta, &az, &baz);
+            _hypocentralDistance = Magnitude_MLA::distance(delta, hypocenter->depth().value());
+        }
+        catch ( ... ) {}
+    }
+
+    _prediction = PreScreen::Unscreened;
+    if ( !_prescreen.enabled || _hypocentralDistance < 0 || _streamKey.empty() )
+        return;
+
+    double magnitude = 0;
+    double time = static_cast<double>(trigger());
+    bool haveMagnitude = false;
+    try {
+        for ( size_t i = 0; i < hypocenter->magnitudeCount(); ++i ) {
+            Seiscomp::DataModel::Magnitude *mag = hypocenter->magnitude(i);
+            if ( mag->type() == _prescreen.magnitudeType ) {
+                magnitude = mag->magnitude().value();
+                haveMagnitude = true;
+            }
+        }
+
+        if ( pick )
+            time = static_cast<double>(pick->time().value());
+    }
+    catch ( ... ) {
+        return;
+    }
+
+    if ( !haveMagnitude )
+        return;
+
+    PreScreen &screen = PreScreen::Instance();
+    double expectedSNR = 0;
+    _prediction = screen.predict(_streamKey, _prescreen, magnitude,
+                                 _hypocentralDistance, time, &expectedSNR);
+
+    if ( _prediction == PreScreen::Fail ) {
+        if ( screen.audit(_streamKey, _prescreen) ) {
+            SEISCOMP_DEBUG("%s: expected SNR %.2f, processing anyway for audit",
+                           _streamKey.c_str(), expectedSNR);
+            return;
+        }
+
+        SEISCOMP_DEBUG("%s: expected SNR %.2f, skipped", _streamKey.c_str(), expectedSNR);
+        setStatus(LowSNR, expectedSNR);
+    }
+}
+
+bool Amplitude_MLA::feed(const Seiscomp::Record *record)
+{
+    GA_ALLOC_SCOPE("mla", "Amplitude_MLA::feed");
+
+    // Publishes the amplitudes filtered on a worker meanwhile, this
+    // processor's among them if it is its turn.
+    AmplitudeExecutor &executor = AmplitudeExecutor::Instance();
+    executor.runCompleted();
+
+    // The window is complete and filtered on a worker, the record is fed
+    // once the amplitude is published, in case the processor continues.
+    if ( _asyncTicket ) {
+        if ( !executor.ready(*_asyncTicket) ) {
+            _asyncPending.push_back(record);
+            return true;
+        }
+
+        finishAsync();
+        if ( isFinished() )
+            return false;
+    }
+
+    // The windows are final once data arrives, so look up the cache with
+    // the first record.
+    if ( _cacheSize > 0 && !_cacheChecked && !isFinished() ) {
+        _cacheChecked = true;
+        // The adaptive window may shorten the signal window later on, the
+        // amplitude is stored under the configured one.
+        _cacheKey = cacheKey();
+
+        AmplitudeCache::Entry entry;
+        if ( AmplitudeCache::Instance().lookup(_cacheKey, &entry) ) {
+            SEISCOMP_DEBUG("%s: amplitude %f taken from cache", _streamKey.c_str(),
+                           entry.result.amplitude.value);
+            // Bypass emitAmplitude() to not store the entry again.
+            AmplitudeProcessor_MLv::emitAmplitude(entry.result);
+            setStatus(Finished, 100.0);
+            return false;
+        }
+    }
+
+    if ( _gaps.maxGap > 0 || _gaps.reorderTime > 0 )
+        return feedOrdered(record);
+
+    return feedContiguous(record);
+}
+
+bool Amplitude_MLA::feedContiguous(const Seiscomp::Record *record)
+{
+    if ( _decimationRate > 0 )
+        return feedDecimated(record);
+
+    return AmplitudeProcessor_MLv::feed(record);
+}
+
+bool Amplitude_MLA::feedOrdered(const Seiscomp::Record *record)
+{
+    const double fsamp = record->samplingFrequency();
+    if ( fsamp <= 0 || record->sampleCount() <= 0 )
+        return false;
+
+    if ( fsamp != _gapRate ) {
+        // Nothing to bridge across a change of the sampling rate
+        releaseHeld(true);
+        _gapRate = fsamp;
+        _nextStart = Seiscomp::Core::Time();
+    }
+
+    if ( _nextStart.valid()
+      && (double)(record->startTime() - _nextStart) > 0.5 / fsamp ) {
+        // Not contiguous, wait for the records in between
+        auto held = _held.emplace(record->startTime(), record);
+        if ( !held.second ) {
+            const bool longer = record->endTime() > held.first->second->endTime();
+            SEISCOMP_DEBUG("%s: second record held at %s, keeping the %s one",
+                           _streamKey.c_str(), record->startTime().iso().c_str(),
+                           longer ? "new" : "first");
+            if ( longer )
+                held.first->second = record;
+        }
+        releaseHeld(false);
+        return true;
+    }
+
+    if ( !_held.empty() )
+        SEISCOMP_DEBUG("%s: late record %s filled a gap", _streamKey.c_str(),
+                       record->startTime().iso().c_str());
+
+    const bool accepted = feedNext(record);
+    releaseHeld(false);
+    return accepted;
+}
+
+bool Amplitude_MLA::feedNext(const Seiscomp::Record *record)
+{
+    if ( !_nextStart.valid() || record->endTime() > _nextStart ) {
+        _nextStart = record->endTime();
+        _lastRecord = record;
+    }
+
+    return feedContiguous(record);
+}
+
+void Amplitude_MLA::flush()
+{
+    if ( !_held.empty() ) {
+        SEISCOMP_DEBUG("%s: closed with %d record(s) held behind a gap",
+                       _streamKey.c_str(), (int)_held.size());
+        releaseHeld(true);
+    }
+
+    if ( _asyncTicket ) {
+        AmplitudeExecutor::Instance().wait(*_asyncTicket);
+        finishAsync();
+    }
+}
+
+void Amplitude_MLA::reset()
+{
+    // The worker may still filter _data, which the base class clears
+    abandonAsync();
+    _asyncFiltered = false;
+    _floatData.clear();
+    Seiscomp::Processing::AmplitudeProcessor_MLv::reset();
+}
+
+void Amplitude_MLA::close() const
+{
+    const_cast<Amplitude_MLA*>(this)->flush();
+}
+
+void Amplitude_MLA::releaseHeld(bool force)
+{
+    while ( !_held.empty() ) {
+        Seiscomp::RecordCPtr next = _held.begin()->second;
+        const double gap = (double)(next->startTime() - _nextStart);
+
+        if ( gap > 0.5 / _gapRate ) {
+            const double held = (double)(_held.rbegin()->second->endTime() - next->startTime());
+            if ( !force && held < _gaps.reorderTime )
+                return;
+
+            if ( gap <= _gaps.maxGap )
+                bridgeGap(next.get());
+            else
+                SEISCOMP_DEBUG("%s: %.3f s gap at %s not bridged", _streamKey.c_str(),
+                               gap, _nextStart.iso().c_str());
+        }
+
+        _held.erase(_held.begin());
+        feedNext(next.get());
+    }
+}
+
+void Amplitude_MLA::bridgeGap(const Seiscomp::Record *next)
+{
+    Seiscomp::DoubleArrayPtr convertedLast, convertedNext;
+    const Seiscomp::DoubleArray *last = asDouble(_lastRecord->data(), convertedLast);
+    const Seiscomp::DoubleArray *first = asDouble(next->data(), convertedNext);
+    if ( !last || !first || last->size() == 0 || first->size() == 0 )
+        return;
+
+    const double from = last->typedData()[last->size() - 1];
+    const double to = first->typedData()[0];
+    const size_t missing = static_cast<size_t>(
+        (double)(next->startTime() - _nextStart) * _gapRate + 0.5);
+
+    std::vector<double> samples(missing, 0.0);
+    if ( _gaps.interpolate ) {
+        for ( size_t i = 0; i < missing; ++i )
+            samples[i] = from + (to - from) * (i + 1) / (missing + 1);
+    }
+
+    Seiscomp::GenericRecordPtr bridge = new Seiscomp::GenericRecord(
+        next->networkCode(), next->stationCode(), next->locationCode(),
+        next->channelCode(), _nextStart, _gapRate);
+    bridge->setData(new Seiscomp::DoubleArray((int)missing, samples.data()));
+    bridge->dataUpdated();
+
+    SEISCOMP_DEBUG("%s: bridged %d missing sample(s) at %s", _streamKey.c_str(),
+                   (int)missing, _nextStart.iso().c_str());
+    feedNext(bridge.get());
+}
+
+bool Amplitude_MLA::feedDecimated(const Seiscomp::Record *record)
+{
+    const double fsamp = record->samplingFrequency();
+    if ( !_decimator || fsamp != _decimatorInputRate ) {
+        const size_t factor = fsamp > 0 ? static_cast<size_t>(fsamp / _decimationRate) : 0;
+        if ( factor < 2 ) {
+            // Already at or below the target rate
+            _decimator.reset();
+            return AmplitudeProcessor_MLv::feed(record);
+        }
+
+        _decimator.reset(new GA::DSP::Decimator(factor));
+        _decimatorInputRate = fsamp;
+        _decimatorEnd = Seiscomp::Core::Time();
+        SEISCOMP_DEBUG("%s: decimating %g Hz by %d with %d taps", _streamKey.c_str(),
+                       fsamp, (int)factor, (int)_decimator->taps());
+    }
+
+    Seiscomp::DoubleArrayPtr converted;
+    const Seiscomp::DoubleArray *data = asDouble(record->data(), converted);
+    if ( !data )
+        return false;
+
+    // The processor starts over after a gap, so does the decimator.
+    if ( _decimatorEnd.valid()
+      && fabs((double)(record->startTime() - _decimatorEnd)) > 0.5 / fsamp )
+        _decimator->reset();
+    _decimatorEnd = record->endTime();
+
+    _decimated.clear();
+    const size_t first = _decimator->apply(data->typedData(), data->size(), _decimated);
+    if ( _decimated.empty() )
+        return true;
+
+    // Time of the first output, corrected for the delay of the lowpass.
+    const Seiscomp::Core::Time start = record->startTime()
+        + Seiscomp::Core::TimeSpan((first - _decimator->delay()) / fsamp);
+
+    Seiscomp::GenericRecordPtr decimated = new Seiscomp::GenericRecord(
+        record->networkCode(), record->stationCode(), record->locationCode(),
+        record->channelCode(), start, fsamp / _decimator->factor());
+    decimated->setData(new Seiscomp::DoubleArray((int)_decimated.size(), _decimated.data()));
+    decimated->dataUpdated();
+
+    return AmplitudeProcessor_MLv::feed(decimated.get());
+}
+
+void Amplitude_MLA::emitAmplitude(const Result &res)
+{
+    if ( _cacheSize > 0 && !_computingProvisional && !_cacheKey.empty() )
+        AmplitudeCache::Instance().store(_cacheKey, res, static_cast<size_t>(_cacheSize));
+
+    AmplitudeProcessor_MLv::emitAmplitude(res);
+}
+
+std::string Amplitude_MLA::cacheKey() const
+{
+    using Seiscomp::Core::toString;
+
+    // Everything the amplitude depends on besides the waveforms: the windows,
+    // the filter chain and what is done to the samples before it, and the
+    // stream's gain and sensor, which change with an inventory update.
+    const Seiscomp::Processing::Stream &stream = streamConfig(VerticalComponent);
+    std::string key = _streamKey + "|" + trigger().iso()
+         + "|" + toString(_config.noiseBegin) + "," + toString(_config.noiseEnd)
+         + "|" + toString(_config.signalBegin) + "," + toString(_config.signalEnd)
+         + "|" + _preFilter + (_singlePrecision ? " f32" : "")
+#if SC_API_VERSION >= SC_API_VERSION_CHECK(12,0,0)
+         + "|WA" + toString(_config.woodAndersonResponse.gain)
+         + "," + toString(_config.woodAndersonResponse.T0)
+         + "," + toString(_config.woodAndersonResponse.h)
+#endif
+         + "|" + toString(_decimationRate)
+         + "|" + toString(_gaps.maxGap) + (_gaps.interpolate ? "l" : "z")
+         + "|" + toString(stream.gain) + " " + stream.gainUnit;
+    if ( stream.sensor() )
+        key += "|" + stream.sensor()->model() + " " + stream.sensor()->unit();
+    // The adaptive window end depends on its settings and the origin
+    if ( _adaptive.enabled )
+        key += "|AW" + toString(_adaptive.envelopeLength) + "," + toString(_adaptive.ratio)
+             + "," + toString(_adaptive.decayTime) + "," + toString(_adaptive.pVelocity)
+             + "," + toString(_adaptive.sVelocity) + "," + toString(_hypocentralDistance);
+    return key;
+}
+
+void Amplitude_MLA::initFilter(double fsamp)
+{
+    // The buffer starts over: reset the detached chain along with the
+    // stream's, and detach it again afterwards.
+    if ( _asyncFilter ) {
+        _stream.filter = _asyncFilter;
+        _asyncFilter = nullptr;
+    }
+    _asyncFiltered = false;
+
+    initFilterChain(fsamp);
+
+    if ( _async ) {
+        _asyncFilter = _stream.filter;
+        _stream.filter = nullptr;
+    }
+}
+
+void Amplitude_MLA::initFilterChain(double fsamp)
+{
+    if ( _externalFilter ) {
+        setFilter(nullptr);
+        Seiscomp::Processing::AmplitudeProcessor::initFilter(fsamp);
+        return;
+    }
+
+    if ( _singlePrecision ) {
+        // The buffer starts over along with the chain
+        _floatData.clear();
+        _floatFilter.reset(createFloatFilter());
+        if ( _floatFilter ) {
+            _floatFilter->setSamplingFrequency(fsamp);
+            setFilter(nullptr);
+            Seiscomp::Processing::AmplitudeProcessor::initFilter(fsamp);
+            return;
+        }
+    }
+
+    if ( !_pooling ) {
+        AmplitudeProcessor_MLv::initFilter(fsamp);
+        return;
+    }
+
+    AmplitudePool &pool = AmplitudePool::Instance();
+    _filterConfig = _preFilter + "@" + Seiscomp::Core::toString(fsamp);
+
+    if ( Filter *filter = pool.acquireFilter(_streamKey, _filterConfig) ) {
+        // A copy of a chain the MLv processor built for the same prefilter
+        // and sampling rate, with fresh state.
+        setFilter(filter);
+        Seiscomp::Processing::AmplitudeProcessor::initFilter(fsamp);
+        return;
+    }
+
+    AmplitudeProcessor_MLv::initFilter(fsamp);
+    if ( _stream.filter )
+        pool.countFilterAllocation();
+}
+
+Seiscomp::Math::Filtering::InPlaceFilter<float> *Amplitude_MLA::createFloatFilter() const
+{
+    using namespace Seiscomp::Math::Filtering;
+
+    // Same chain as AbstractAmplitudeProcessor_ML::initFilter
+    std::unique_ptr<ChainFilter<float>> chain(new ChainFilter<float>);
+
+    if ( !_preFilter.empty() ) {
+        std::string error;
+        InPlaceFilter<float> *preFilter = InPlaceFilter<float>::Create(_preFilter, &error);
+        if ( !preFilter ) {
+            SEISCOMP_ERROR("%s: invalid prefilter %s: %s", _streamKey.c_str(),
+                           _preFilter.c_str(), error.c_str());
+            return nullptr;
+        }
+        chain->add(preFilter);
+    }
+
+#if SC_API_VERSION >= SC_API_VERSION_CHECK(12,0,0)
+    chain->add(new IIR::WoodAndersonFilter<float>(Seiscomp::Math::Velocity,
+                                                  _config.woodAndersonResponse));
+#else
+    chain->add(new IIR::WoodAndersonFilter<float>(Seiscomp::Math::Velocity));
+#endif
+
+    return chain.release();
+}
+
+void Amplitude_MLA::fill(size_t n, double *samples)
+{
+    if ( !_floatFilter ) {
+        AmplitudeProcessor_MLv::fill(n, samples);
+        return;
+    }
+
+    const size_t offset = _floatData.size();
+    _floatData.resize(static_cast<int>(offset + n));
+    float *window = _floatData.typedData() + offset;
+    for ( size_t i = 0; i < n; ++i )
+        window[i] = static_cast<float>(samples[i]);
+
+    _floatFilter->apply(static_cast<int>(n), window);
+}
+
+void Amplitude_MLA::widenFloatData()
+{
+    const size_t widened = _data.size();
+    const size_t n = _floatData.size();
+    if ( n <= widened )
+        return;
+
+    _data.resize(static_cast<int>(n));
+    const float *from = _floatData.typedData();
+    double *to = _data.typedData();
+    for ( size_t i = widened; i < n; ++i )
+        to[i] = from[i];
+}
+
+bool Amplitude_MLA::windowComplete()
+{
+    const Seiscomp::Core::TimeWindow &needed = timeWindow();
+    if ( dataTimeWindow().endTime() >= needed.endTime() )
+        return true;
+
+    const double length = needed.length();
+    const double available = (double)(dataTimeWindow().endTime() - needed.startTime());
+    setStatus(InProgress, length > 0 ? std::max(0.0, 100.0 * available / length) : 0.0);
+    return false;
+}
+
 void Amplitude_MLA::setDefaultConfiguration()
 {
     Seiscomp::Processing::AmplitudeProcessor_MLv::setDefaultConfiguration();
@@ -106,6 +728,299 @@ bool Amplitude_MLA::setParameter(Capability cap, const std::string &value)
     return false;
 }
 
+void Amplitude_MLA::process(const Seiscomp::Record *record,
+                            const Seiscomp::DoubleArray &filteredData)
+{
+    if ( _async && !_asyncFiltered ) {
+        if ( !windowComplete() )
+            return;
+
+        _asyncTail = _data.size() - filteredData.size();
+        submitAsync(record);
+        return;
+    }
+
+    if ( _floatFilter ) {
+        if ( !windowComplete() )
+            return;
+
+        // The samples of the record, filtered, at the end of the window
+        widenFloatData();
+        const size_t tail = _data.size() - std::min((size_t)filteredData.size(), (size_t)_data.size());
+        Seiscomp::DoubleArray filtered((int)(_data.size() - tail), _data.typedData() + tail);
+        Seiscomp::Processing::AmplitudeProcessor_MLv::process(record, filtered);
+        return;
+    }
+
+    Seiscomp::Processing::AmplitudeProcessor_MLv::process(record, filteredData);
+
+    if ( _adaptive.enabled && !isFinished() && adaptWindowEnd() ) {
+        // Let the base class compute the final amplitude for the shortened
+        // window from the data already buffered.
+        Seiscomp::Processing::AmplitudeProcessor_MLv::process(record, filteredData);
+    }
+
+    if ( _provisional.enabled && !isFinished() )
+        emitProvisional(record);
+}
+
+void Amplitude_MLA::submitAsync(const Seiscomp::Record *record)
+{
+    AmplitudeExecutor &executor = AmplitudeExecutor::Instance();
+    _asyncRecord = record;
+    _asyncTicket = executor.submit(_streamKey, [this]() { filterAsync(); },
+                                   [this]() { finishAsync(); });
+
+    // Run inline because of backpressure, or a worker was quick
+    if ( executor.ready(*_asyncTicket) )
+        finishAsync();
+}
+
+void Amplitude_MLA::filterAsync()
+{
+    // The chains have seen no samples since initFilter(), the result is the
+    // same as filtering record by record.
+    const size_t n = _data.size();
+    double *samples = _data.typedData();
+    if ( _asyncFilter )
+        _asyncFilter->apply(static_cast<int>(n), samples);
+}
+
+void Amplitude_MLA::finishAsync()
+{
+    if ( !_asyncTicket )
+        return;
+
+    AmplitudeExecutor &executor = AmplitudeExecutor::Instance();
+    Seiscomp::RecordCPtr record = _asyncRecord;
+    _asyncRecord = nullptr;
+    _asyncFiltered = true;
+
+    // The filtered samples of the record that completed the window.
+    const size_t tail = std::min(_asyncTail, (size_t)_data.size());
+    Seiscomp::DoubleArray filteredData((int)(_data.size() - tail), _data.typedData() + tail);
+    process(record.get(), filteredData);
+
+    // Only now may the next processor of the stream publish.
+    executor.release(*_asyncTicket);
+    _asyncTicket.reset();
+
+    // The chain state matches the end of the buffer, continue synchronously.
+    if ( _asyncFilter ) {
+        _stream.filter = _asyncFilter;
+        _asyncFilter = nullptr;
+    }
+
+    // Feed the records kept while the worker filtered, unless they are no
+    // longer needed. A new window may open a ticket again and keep the rest.
+    std::vector<Seiscomp::RecordCPtr> pending;
+    pending.swap(_asyncPending);
+    for ( const Seiscomp::RecordCPtr &rec : pending ) {
+        if ( isFinished() )
+            break;
+        feed(rec.get());
+    }
+}
+
+void Amplitude_MLA::abandonAsync()
+{
+    if ( _asyncTicket ) {
+        AmplitudeExecutor &executor = AmplitudeExecutor::Instance();
+        executor.wait(*_asyncTicket);
+        executor.release(*_asyncTicket);
+        _asyncTicket.reset();
+    }
+    _asyncRecord = nullptr;
+    _asyncPending.clear();
+
+    // Give the detached chain back to the stream, which owns it.
+    if ( _asyncFilter ) {
+        _stream.filter = _asyncFilter;
+        _asyncFilter = nullptr;
+    }
+}
+
+bool Amplitude_MLA::adaptWindowEnd()
+{
+    const double fsamp = _stream.fsamp;
+    if ( fsamp <= 0 || !trigger().valid() || _hypocentralDistance < 0 )
+        return false;
+
+    // The ML peak is carried by the S waves: a P peak followed by its coda
+    // must not end the window before S has arrived.
+    const double sDelay = _hypocentralDistance / _adaptive.sVelocity
+                        - _hypocentralDistance / _adaptive.pVelocity;
+
+    const Seiscomp::Core::Time start = dataTimeWindow().startTime();
+    const double triggerOffset = (trigger() - start) * fsamp;
+    const int s1 = (int)(triggerOffset + std::max(_config.signalBegin, sDelay) * fsamp);
+    const int s2 = std::min((int)(triggerOffset + _config.signalEnd * fsamp), (int)_data.size());
+    const size_t length = std::max((size_t)(_adaptive.envelopeLength * fsamp), size_t(1));
+    if ( s1 < 0 || s2 <= s1 )
+        return false;
+
+    // The buffer starts over after a gap
+    if ( _envelope.next > (size_t)_data.size() )
+        _envelope = Envelope();
+
+    // Envelope: mean absolute value over envelopeLength seconds, updated with
+    // the samples added since the last record.
+    size_t i = std::max(_envelope.next, (size_t)s1);
+    for ( ; i < (size_t)s2; ++i ) {
+        _envelope.sum += fabs(_data[i]);
+        if ( i >= s1 + length )
+            _envelope.sum -= fabs(_data[i - length]);
+        if ( i + 1 < s1 + length )
+            continue;
+
+        const double envelope = _envelope.sum / length;
+        if ( envelope > _envelope.maximum ) {
+            _envelope.maximum = envelope;
+            _envelope.maximumIndex = i;
+        }
+        else if ( envelope < _adaptive.ratio * _envelope.maximum
+               && (i - _envelope.maximumIndex) >= _adaptive.decayTime * fsamp ) {
+            break;
+        }
+    }
+    _envelope.next = i;
+
+    if ( i >= (size_t)s2 )
+        return false;
+
+    // The peak has passed: end the window here.
+    const double end = (i + 1 - triggerOffset) / fsamp;
+    if ( end >= _config.signalEnd )
+        return false;
+
+    SEISCOMP_INFO("%s: envelope decayed to %.0f%% of its maximum after S (%.1fs), "
+                  "signal window %.1fs - %.1fs instead of %.1fs", _streamKey.c_str(),
+                  100.0 * _adaptive.ratio, sDelay, _config.signalBegin, end,
+                  _config.signalEnd);
+    setSignalEnd(end);
+    return true;
+}
+
+void Amplitude_MLA::emitProvisional(const Seiscomp::Record *record)
+{
+    // Every provisional amplitude is emitted for the same pick; only hosts
+    // that update the amplitude already sent for it may receive more than one.
+    if ( !isUpdateEnabled() ) {
+        if ( !_provisionalWarned ) {
+            SEISCOMP_WARNING("%s: provisional amplitudes need amplitude updates "
+                             "enabled by the application, not publishing them",
+                             _streamKey.c_str());
+            _provisionalWarned = true;
+        }
+        return;
+    }
+
+    const double fsamp = _stream.fsamp;
+    if ( fsamp <= 0 || _data.size() == 0 || !trigger().valid() )
+        return;
+
+    const Seiscomp::Core::Time start = dataTimeWindow().startTime();
+    const Seiscomp::Core::Time end = dataTimeWindow().endTime();
+
+    // Sample indices relative to the start of the buffered data, computed
+    // the same way as the base class does for the complete window.
+    const double triggerOffset = (trigger() - start) * fsamp;
+    const int n1 = (int)(triggerOffset + _config.noiseBegin * fsamp);
+    const int n2 = (int)(triggerOffset + _config.noiseEnd * fsamp);
+    const int s1 = (int)(triggerOffset + _config.signalBegin * fsamp);
+    const int s2 = std::min((int)(triggerOffset + _config.signalEnd * fsamp), (int)_data.size());
+    if ( n1 < 0 || n2 <= n1 || s1 < 0 || s2 <= s1 )
+        return;
+
+    ProvisionalState &state = _provisionalState;
+
+    // The buffer starts over after a gap
+    if ( state.next > (size_t)_data.size() ) {
+        const double published = state.published;
+        state = ProvisionalState();
+        state.published = published;
+    }
+
+    // The running peak only tells when to measure. It is followed on the
+    // buffered samples, against the noise offset of the buffer; the noise
+    // window is complete once signal arrives.
+    if ( !state.haveNoise ) {
+        if ( !computeNoise(_data, n1, n2, &state.noiseOffset, &state.noiseAmplitude) )
+            return;
+        state.haveNoise = true;
+    }
+
+    // Running peak, updated with the samples added since the last record
+    size_t i = std::max(state.next, (size_t)s1);
+    for ( ; i < (size_t)s2; ++i ) {
+        const double value = fabs(_data[i] - state.noiseOffset);
+        if ( value > state.peak ) {
+            state.peak = value;
+            state.peakIndex = i;
+            state.peakChanged = true;
+        }
+    }
+    state.next = i;
+
+    const double window = _config.signalEnd - _config.signalBegin;
+    if ( !state.peakChanged ||
+         end - trigger() < _config.signalBegin + _provisional.fraction * window )
+        return;
+
+    const Seiscomp::Core::Time peak = start + Seiscomp::Core::TimeSpan(state.peakIndex / fsamp);
+    if ( end - peak < _provisional.stableTime )
+        return;
+
+    // The peak settled: measure the partial window once. The final
+    // amplitude is measured on the data after prepareData(), e.g. with the
+    // response deconvolved, so the partial window goes through the same
+    // step, on a copy as the buffer keeps filling.
+    state.peakChanged = false;
+    Seiscomp::DoubleArray prepared(s2, _data.typedData());
+    if ( !prepareData(prepared) )
+        return;
+
+    double preparedOffset, preparedAmplitude;
+    if ( !computeNoise(prepared, n1, n2, &preparedOffset, &preparedAmplitude) )
+        return;
+
+    // The base class keeps its own noise for the final amplitude
+    const OPT(double) noiseOffset = _noiseOffset;
+    const OPT(double) noiseAmplitude = _noiseAmplitude;
+    _noiseOffset = preparedOffset;
+    _noiseAmplitude = preparedAmplitude;
+
+    AmplitudeIndex dt{0, 0, 0};
+    AmplitudeValue amplitude;
+    double period = -1, snr = -1;
+    _computingProvisional = true;
+    const bool ok = computeAmplitude(prepared, s1, s2, s1, s2, preparedOffset,
+                                     &dt, &amplitude, &period, &snr);
+    _computingProvisional = false;
+    _noiseOffset = noiseOffset;
+    _noiseAmplitude = noiseAmplitude;
+    if ( !ok || amplitude.value <= state.published )
+        return;
+
+    Result res;
+    res.record = record;
+    res.amplitude = amplitude;
+    res.time.reference = start + Seiscomp::Core::TimeSpan(dt.index / fsamp);
+    res.time.begin = (dt.begin - dt.index) / fsamp;
+    res.time.end = (dt.end - dt.index) / fsamp;
+    res.period = period > 0 ? period / fsamp : period;
+    res.snr = snr;
+
+    SEISCOMP_DEBUG("%s: provisional amplitude %f after %.1fs of %.1fs signal",
+                   _streamKey.c_str(), amplitude.value,
+                   (double)(end - trigger()) - _config.signalBegin, window);
+
+    state.published = amplitude.value;
+    _computingProvisional = true;
+    emitAmplitude(res);
+    _computingProvisional = false;
+}
+
 bool Amplitude_MLA::computeAmplitude(const Seiscomp::DoubleArray &data,
         size_t i1, size_t i2,
         size_t si1, size_t si2,
@@ -113,6 +1028,9 @@ bool Amplitude_MLA::computeAmplitude(const Seiscomp::DoubleArray &data,
         AmplitudeIndex *dt, AmplitudeValue *amplitude,
         double *period, double *snr)
 {
+    GA_TRACE_SCOPE("mla", "Amplitude_MLA::computeAmplitude");
+    GA_ALLOC_SCOPE("mla", "Amplitude_MLA::computeAmplitude");
+
     bool retVal = Seiscomp::Processing::AmplitudeProcessor_MLv::computeAmplitude(
         data,
         i1, i2,
@@ -126,6 +1044,14 @@ bool Amplitude_MLA::computeAmplitude(const Seiscomp::DoubleArray &data,
     if (retVal)
     {
         amplitude->value *= 0.5;
+        if ( _computingProvisional )
+            return retVal;
+        if ( _pooling )
+            AmplitudePool::Instance().countAmplitude();
+        if ( _prescreen.enabled )
+            PreScreen::Instance().recordResult(_streamKey, _prescreen, _prediction,
+                                               static_cast<double>(trigger()),
+                                               amplitude->value, *snr);
     }
 
     return retVal;
@@ -139,6 +1065,7 @@ bool Amplitude_MLA::computeAmplitude(const Seiscomp::DoubleArray &data,
 //  MLa MAGNITUDE PROCESSOR.
 
 // Register the magnitude processor.
+IMPLEMENT_SC_CLASS_DERIVED(Magnitude_MLA, MagnitudeProcessor, "Magnitude_MLA");
 REGISTER_MAGNITUDEPROCESSOR(Magnitude_MLA, GA_ML_AUS_MAG_TYPE);
 
 Magnitude_MLA::Magnitude_MLA(const std::string& type) 
@@ -155,6 +1082,232 @@ std::string Magnitude_MLA::amplitudeType() const
     return GA_ML_AUS_AMP_TYPE;
 }
 
+#if SC_API_VERSION >= SC_API_VERSION_CHECK(15,0,0)
+bool Magnitude_MLA::setup(const Seiscomp::Processing::Settings &settings)
+{
+    _regions.clear();
+    _regionCalcs.clear();
+    _regionIndex.clear();
+    _originRegion = OriginRegion();
+    _indexedLookup = true;
+    _pool = nullptr;
+
+    if ( !Seiscomp::Processing::MagnitudeProcessor::setup(settings) )
+        return false;
+
+    std::vector<const Seiscomp::Geo::GeoFeature*> features;
+    for ( const Locale &locale : _regions )
+        features.push_back(locale.feature);
+    _regionIndex.build(features);
+
+    // The calling thread is one of them
+    int threads = 0;
+    settings.getValue(threads, std::string("magnitudes.") + type() + ".threads");
+    _pool = threads > 1 ? std::make_shared<WorkerPool>(threads - 1) : nullptr;
+
+    SEISCOMP_DEBUG("%s: indexed %d region(s), indexed lookup %s", type(),
+                   (int)_regionIndex.size(), _indexedLookup ? "enabled" : "disabled");
+    return true;
+}
+
+bool Magnitude_MLA::initLocale(Locale *locale,
+                               const Seiscomp::Processing::Settings &settings,
+                               const std::string &configPrefix)
+{
+    if ( !Seiscomp::Processing::MagnitudeProcessor::initLocale(locale, settings, configPrefix) )
+        return false;
+
+    if ( !locale->feature || locale->check != Locale::Source )
+        _indexedLookup = false;
+
+    // The region ID is the position in _regions; resolve its formula once
+    // here instead of by name for every station magnitude.
+    auto it = regionToCalcMap.find(locale->name);
+    if ( it == regionToCalcMap.end() )
+        SEISCOMP_ERROR("Unknown MLa region name %s", locale->name.c_str());
+
+    _regions.push_back(*locale);
+    _regionCalcs.push_back(it != regionToCalcMap.end() ? it->second : nullptr);
+    return true;
+}
+
+Seiscomp::Processing::MagnitudeProcessor::Status Magnitude_MLA::computeMagnitude(
+      double amplitudeValue,
+      const std::string &unit,
+      double period,
+      double snr,
+      double delta,
+      double depth,
+      const Seiscomp::DataModel::Origin *hypocenter,
+      const Seiscomp::DataModel::SensorLocation *receiver,
+      const Seiscomp::DataModel::Amplitude *amplitude,
+      double &value)
+{
+    GA_TRACE_SCOPE("mla", "Magnitude_MLA::computeMagnitude");
+    GA_ALLOC_SCOPE("mla", "Magnitude_MLA::computeMagnitude");
+
+    double lat = 0, lon = 0;
+    bool haveEpicenter = false;
+    if ( _indexedLookup && !_regions.empty() && hypocenter ) {
+        try {
+            lat = hypocenter->latitude().value();
+            lon = hypocenter->longitude().value();
+            haveEpicenter = true;
+        }
+        catch ( ... ) {}
+    }
+
+    if ( !haveEpicenter ) {
+        return Seiscomp::Processing::MagnitudeProcessor::computeMagnitude(
+            amplitudeValue, unit, period, snr, delta, depth,
+            hypocenter, receiver, amplitude, value);
+    }
+
+    _treatAsValidMagnitude = false;
+
+    if ( amplitudeValue <= 0 )
+        return AmplitudeOutOfRange;
+
+    const size_t region = originRegion(hypocenter->publicID(), lat, lon);
+    if ( region == GA::Geo::FeatureIndex::npos )
+        return EpicenterOutOfRegions;
+
+    const Status limits = checkRegionLimits(region, delta, depth);
+    if ( limits != OK )
+        return limits;
+
+    const MagCalc calcFunction = _regionCalcs[region];
+    if ( !calcFunction ) {
+        SEISCOMP_ERROR("Unknown MLa region name %s", _regions[region].name.c_str());
+        return DistanceOutOfRange;
+    }
+
+    return applyFormula(calcFunction, amplitudeValue, period, snr, delta, depth, value);
+}
+
+Seiscomp::Processing::MagnitudeProcessor::Status Magnitude_MLA::checkRegionLimits(
+      size_t region, double delta, double depth) const
+{
+    // Same per-region limits the base class applies to a matching locale
+    const Locale &locale = _regions[region];
+    if ( (locale.minimumDepth && depth < *locale.minimumDepth)
+      || (locale.maximumDepth && depth > *locale.maximumDepth) )
+        return DepthOutOfRange;
+    if ( (locale.minimumDistance && delta < *locale.minimumDistance)
+      || (locale.maximumDistance && delta > *locale.maximumDistance) )
+        return DistanceOutOfRange;
+    return OK;
+}
+
+std::vector<Magnitude_MLA::StationMagnitude> Magnitude_MLA::computeStationMagnitudes(
+      const Seiscomp::DataModel::Origin *hypocenter,
+      const std::vector<StationInput> &stations) const
+{
+    return computeStationMagnitudes(hypocenter, stations, 1);
+}
+
+std::vector<Magnitude_MLA::StationMagnitude> Magnitude_MLA::computeStationMagnitudes(
+      const Seiscomp::DataModel::Origin *hypocenter,
+      const std::vector<StationInput> &stations,
+      size_t types) const
+{
+    GA_TRACE_SCOPE("mla", "Magnitude_MLA::computeStationMagnitudes");
+
+    std::vector<StationMagnitude> results(stations.size());
+    if ( stations.empty() )
+        return results;
+
+    if ( types == 0 || stations.size() % types != 0 ) {
+        SEISCOMP_ERROR("%s: %d station input(s) are not a multiple of %d type(s)", type(),
+                       (int)stations.size(), (int)types);
+        return results;
+    }
+
+    if ( !_indexedLookup || _regions.empty() || !hypocenter ) {
+        SEISCOMP_WARNING("%s: regions cannot be resolved from the epicentre", type());
+        return results;
+    }
+
+    // Resolved here rather than through the per-origin cache, so that
+    // concurrent calls share no state
+    size_t region;
+    try {
+        region = _regionIndex.lookup(hypocenter->latitude().value(),
+                                     hypocenter->longitude().value());
+    }
+    catch ( ... ) {
+        return results;
+    }
+
+    // The formula of the region, which computeMag*() apply per amplitude
+    GA::Core::MLa::Region formula = GA::Core::MLa::Region::West;
+    const bool haveFormula = region != GA::Geo::FeatureIndex::npos
+                          && _regionCalcs[region]
+                          && GA::Core::MLa::regionByName(_regions[region].name, formula);
+
+    auto evaluateStation = [&](size_t i) {
+        const StationInput *inputs = &stations[i * types];
+        StationMagnitude *station = &results[i * types];
+
+        // Shared by all amplitudes of the station
+        Status status = EpicenterOutOfRegions;
+        if ( region != GA::Geo::FeatureIndex::npos ) {
+            status = checkRegionLimits(region, inputs[0].delta, inputs[0].depth);
+            if ( status == OK && !haveFormula )
+                status = DistanceOutOfRange;
+        }
+
+        double correction = 0;
+        if ( status == OK )
+            correction = GA::Core::MLa::correction(formula, distance(inputs[0].delta, inputs[0].depth));
+
+        for ( size_t t = 0; t < types; ++t ) {
+            StationMagnitude &result = station[t];
+            if ( inputs[t].amplitude <= 0 ) {
+                result.status = AmplitudeOutOfRange;
+                continue;
+            }
+            result.status = status;
+            if ( status != OK )
+                continue;
+
+            // GA::Core::MLa::magnitude() with the correction computed once
+            result.value = log10(inputs[t].amplitude) + correction;
+            checkSNR(inputs[t].snr, result);
+        }
+    };
+
+    const size_t count = stations.size() / types;
+    if ( _pool )
+        _pool->parallelFor(count, evaluateStation);
+    else {
+        for ( size_t i = 0; i < count; ++i )
+            evaluateStation(i);
+    }
+
+    return results;
+}
+
+size_t Magnitude_MLA::originRegion(const std::string &originID, double lat, double lon)
+{
+    // Station magnitudes arrive grouped by origin, so remembering the last
+    // origin is enough to run the polygon test once per origin.
+    std::lock_guard<std::mutex> lock(_originRegionMutex);
+    if ( !_originRegion.valid
+      || _originRegion.originID != originID
+      || _originRegion.lat != lat
+      || _originRegion.lon != lon ) {
+        _originRegion.originID = originID;
+        _originRegion.lat = lat;
+        _originRegion.lon = lon;
+        _originRegion.region = _regionIndex.lookup(lat, lon);
+        _originRegion.valid = true;
+    }
+
+    return _originRegion.region;
+}
+#endif
+
 Seiscomp::Processing::MagnitudeProcessor::Status Magnitude_MLA::computeMagnitude(
       double amplitudeValue, // in millimetres
       const std::string &unit,
@@ -168,6 +1321,9 @@ Seiscomp::Processing::MagnitudeProcessor::Status Magnitude_MLA::computeMagnitude
       const Seiscomp::Processing::MagnitudeProcessor::Locale *locale,
       double &value)
 {
+    GA_TRACE_SCOPE("mla", "Magnitude_MLA::computeMagnitude(locale)");
+    GA_ALLOC_SCOPE("mla", "Magnitude_MLA::computeMagnitude(locale)");
+
     // _treatAsValidMagnitude is returned when treatAsValidMagnitude() is called, which is a
     // follow-up check performed only when the returned status is not OK. We set this
     // flag if we're returning non-OK but want the stamag to still be created (just
@@ -193,28 +1349,79 @@ Seiscomp::Processing::MagnitudeProcessor::Status Magnitude_MLA::computeMagnitude
         return DistanceOutOfRange;
     }
 
-    Seiscomp::Processing::MagnitudeProcessor::Status status = (this->*calcFunction)(amplitudeValue, period, delta, depth, value);
+    return applyFormula(calcFunction, amplitudeValue, period, snr, delta, depth, value);
+}
+
+Magnitude_MLA::StationMagnitude Magnitude_MLA::evaluate(
+      MagCalc calcFunction, const StationInput &input) const
+{
+    StationMagnitude result;
+    result.status = (this->*calcFunction)(
+        input.amplitude, input.period, input.delta, input.depth, result.value);
+    checkSNR(input.snr, result);
+    return result;
+}
 
+void Magnitude_MLA::checkSNR(double snr, StationMagnitude &result) const
+{
     if ( _minimumSNR && snr < *_minimumSNR ) {
         // magtool logic is as follows:
         // 1. If status == OK, accept station magnitude with passedQC = true
         // 2. If status != OK but treatAsValidMagnitude(), accept station magnitude with passedQC = false
         // 3. If status != OK and !treatAsValidMagnitude(), exclude station magnitude entirely
-        // When SNR check fails we want option 2, so we set the _treatAsValidMagnitude flag and return SNROutOfRange.
-        status = SNROutOfRange;
-        _treatAsValidMagnitude = true;
+        // When SNR check fails we want option 2, so we flag the result as valid and return SNROutOfRange.
+        result.status = SNROutOfRange;
+        result.treatAsValid = true;
+    }
+}
+
+Seiscomp::Processing::MagnitudeProcessor::Status Magnitude_MLA::applyFormula(
+      MagCalc calcFunction,
+      double amplitudeValue, // in millimetres
+      double period,         // in seconds
+      double snr,
+      double delta,          // in degrees
+      double depth,          // in kilometres
+      double &value)
+{
+    const StationMagnitude result =
+        evaluate(calcFunction, { amplitudeValue, period, snr, delta, depth });
+
+    value = result.value;
+    _treatAsValidMagnitude = result.treatAsValid;
+
+    if ( result.status == SNROutOfRange ) {
         SEISCOMP_DEBUG("%s SNR = %.1f is less than minSNR = %.1f.", type(), snr, *_minimumSNR);
-    } else {
+    } else if ( _minimumSNR ) {
         SEISCOMP_DEBUG("%s SNR = %.1f is greater than minSNR = %.1f.", type(), snr, *_minimumSNR);
     }
 
-    return status;
+    return result.status;
 }
 
 double Magnitude_MLA::distance(double delta, double depth)
 {
-    double deltaKms = Seiscomp::Math::Geo::deg2km(delta);
-    return sqrt(pow(depth, 2) + pow(deltaKms, 2));
+    return GA::Core::MLa::hypocentralDistance(Seiscomp::Math::Geo::deg2km(delta), depth);
+}
+
+double Magnitude_MLA::correctionWest(double r)
+{
+    return GA::Core::MLa::correctionWest(r);
+}
+
+double Magnitude_MLA::correctionEast(double r)
+{
+    return GA::Core::MLa::correctionEast(r);
+}
+
+double Magnitude_MLA::correctionSouth(double r)
+{
+    return GA::Core::MLa::correctionSouth(r);
+}
+
+double Magnitude_MLA::smallestCorrection(double r)
+{
+    return GA::Core::MLa::smallestCorrection(r);
 }
 
 // Calculates the ml magnitude for the west region (Western Australia).
@@ -228,12 +1435,10 @@ Seiscomp::Processing::MagnitudeProcessor::Status Magnitude_MLA::computeMagWest(
       double period,      // in seconds
       double delta,       // in degrees
       double depth,       // in kilometres
-      double &value)
+      double &value) const
 {
     double r = Magnitude_MLA::distance(delta, depth);
-    value = (
-            log10(amplitude) + (1.137 * log10(r)) +
-            (0.000657 * r) + 0.66);
+    value = GA::Core::MLa::magnitude(GA::Core::MLa::Region::West, amplitude, r);
     return OK;
 }
 
@@ -248,12 +1453,10 @@ Seiscomp::Processing::MagnitudeProcessor::Status Magnitude_MLA::computeMagEast(
       double period,      // in seconds
       double delta,       // in degrees
       double depth,       // in kilometres
-      double &value)
+      double &value) const
 {
     double r = Magnitude_MLA::distance(delta, depth);
-    value = (
-            log10(amplitude) + (1.34 * log10(r / 100)) +
-            (0.00055 * (r - 100)) + 3.13);
+    value = GA::Core::MLa::magnitude(GA::Core::MLa::Region::East, amplitude, r);
     return OK;
 }
 
@@ -268,12 +1471,10 @@ Seiscomp::Processing::MagnitudeProcessor::Status Magnitude_MLA::computeMagSouth(
       double period,      // in seconds
       double delta,       // in degrees
       double depth,       // in kilometres
-      double &value)
+      double &value) const
 {
     double r = Magnitude_MLA::distance(delta, depth);
-    value = (
-            log10(amplitude) + (1.1 * log10(r)) +
-            (0.0013 * r) + 0.7);
+    value = GA::Core::MLa::magnitude(GA::Core::MLa::Region::South, amplitude, r);
     return OK;
 }
 
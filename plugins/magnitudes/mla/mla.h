@@ -13,8 +13,20 @@
 #include <seiscomp/core/plugin.h>
 #include <seiscomp/geo/featureset.h>
 
+#include <ga/dsp/decimator.h>
+#include <ga/geo/featureindex.h>
+
+#include "amplitudeexecutor.h"
+#include "prescreen.h"
+
+#include <cctype>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <map>
+#include <vector>
+
+class WorkerPool;
 
 /*
 Calculates the MLa amplitude. This amplitude value is used by the MLa magnitude
@@ -34,6 +46,13 @@ public:
     */
     explicit Amplitude_MLA(const std::string& type=GA_ML_AUS_AMP_TYPE);
 
+    /*
+    Destructor. Waits for an asynchronous filter task still running on the
+    buffer, then hands the sample buffer and filter chain back to the
+    AmplitudePool for the next processor of the same stream.
+    */
+    ~Amplitude_MLA() override;
+
     /*
     Returns the capabilities of the processor. This will be NoCapability.
     @returns: Capability of processor (NoCapability).
@@ -42,6 +61,75 @@ public:
 
     bool setup(const Seiscomp::Processing::Settings &settings) override;
 
+    /*
+    For tools that filter the waveforms before feeding them, like
+    mla-replay --lockstep; there is no configuration parameter for it and
+    scamp never calls it. Declares that the fed samples already went through
+    filter followed by the Wood-Anderson simulation, so the processor sets
+    up no filter chain of its own. Call after setup() and before the first
+    record. Returns false and keeps filtering if filter is not the
+    configured prefilter. Defined here as tools load the plugin at runtime
+    and do not link against it.
+    */
+    bool setExternalFilter(const std::string &filter)
+    {
+        if ( withoutSpaces(filter) != withoutSpaces(_preFilter) )
+            return false;
+
+        _externalFilter = true;
+        // The detached chain of the asynchronous mode is not needed.
+        _async = false;
+        return true;
+    }
+
+    /*
+    Extends the base class by the optional pre-screen
+    (amplitudes.<type>.prescreen.*): if the provisional magnitude of the
+    origin and the noise history of the stream predict an SNR too low for a
+    magnitude, the processor finishes with status LowSNR without waiting
+    for data. Also keeps the hypocentral distance, from which the adaptive
+    window end predicts the S arrival.
+    */
+    void setEnvironment(const Seiscomp::DataModel::Origin *hypocenter,
+                        const Seiscomp::DataModel::SensorLocation *receiver,
+                        const Seiscomp::DataModel::Pick *pick) override;
+
+    /*
+    Extends the base class by the amplitude cache
+    (amplitudes.<type>.cacheSize): if an amplitude for the same stream,
+    pick time, windows and configuration (cacheKey()) was computed before,
+    the first record makes the processor publish it and finish without
+    processing data.
+    With amplitudes.<type>.decimationRate, records of streams sampled at
+    least twice as fast are decimated to that rate first, see
+    feedDecimated(). With amplitudes.<type>.gaps.* short gaps are bridged
+    and records arriving out of order are put back in order, see
+    feedOrdered(). In asynchronous mode records arriving while the
+    completed window is filtered are kept and fed once the amplitude is
+    published, see submitAsync(). Every call first publishes the
+    amplitudes whose filtering has finished, of any stream.
+    */
+    bool feed(const Seiscomp::Record *record) override;
+
+    // Waits for the filtering of a completed window in asynchronous mode,
+    // so that the base class may clear the buffer.
+    void reset() override;
+
+    /*
+    Ends the data of the stream: records held back behind a gap
+    (amplitudes.<type>.gaps.reorderTime) are fed without waiting any
+    longer, so that a stream stalling behind a gap still completes its
+    window, and in asynchronous mode the filtering of a completed window is
+    waited for and its amplitude published. Hosts that stop feeding a
+    processor before it finished, e.g. at the end of a replay or on a
+    timeout, call close().
+    */
+    void flush();
+
+    // Calls flush(). The base class declares close() const although the
+    // processor finishes its work in it.
+    void close() const override;
+
     /*
     Creates the parameter options associated with the capability.
     @param cap: The capability to create parameters for.
@@ -63,6 +151,49 @@ protected:
     virtual std::string defaultFilter() const { return ""; };
     void setDefaultConfiguration() override; 
 
+    /*
+    Takes over a pooled filter chain for this stream, prefilter and sampling
+    rate if there is one, otherwise lets the MLv processor build it. After
+    setExternalFilter() the fed samples are already filtered and no chain is
+    set up. In asynchronous mode the chain is detached until the signal
+    window is complete, see submitAsync(). With
+    amplitudes.<type>.singlePrecision the chain is built in float instead
+    and applied by fill().
+    */
+    void initFilter(double fsamp) override;
+
+    /*
+    In single precision the samples are converted to float once, appended
+    to the float window and filtered there in place; the double buffer of
+    the base class stays empty until the window is complete, see process().
+    Otherwise as in the base class.
+    */
+    void fill(size_t n, double *samples) override;
+
+    /*
+    Extends the base class by the adaptive window end
+    (amplitudes.<type>.adaptiveWindow.*, see adaptWindowEnd()) and by
+    provisional amplitudes
+    (amplitudes.<type>.provisional.*): once the configured fraction of the
+    signal window is available and its running peak has not changed for
+    stableTime seconds, the amplitude of the partial window is published,
+    measured after the same prepareData() step as the final amplitude.
+    It is published again whenever the peak grows. The final amplitude is
+    computed and published by the base class unchanged, with the same pick
+    reference and type. Since every emission is for the same pick,
+    provisional amplitudes are only published if the application updates
+    the amplitude it sent before (isUpdateEnabled()).
+    In asynchronous mode (amplitudes.<type>.async.*) the completed window
+    is handed to the AmplitudeExecutor instead, see submitAsync(). In single
+    precision the completed float window is widened to double once, for
+    the base class to measure noise and amplitude on.
+    */
+    void process(const Seiscomp::Record *record,
+                 const Seiscomp::DoubleArray &filteredData) override;
+
+    // Stores final amplitudes in the AmplitudeCache, if enabled.
+    void emitAmplitude(const Result &res) override;
+
     /*
     Computes the amplitude of data in the range[i1, i2].
     Input parameters:
@@ -93,6 +224,216 @@ protected:
             double offset,
             AmplitudeIndex *dt, AmplitudeValue *amplitude,
             double *period, double *snr) override;
+
+private:
+    // Stream and amplitude type (NET.STA.LOC.CHA.type), the key of this
+    // processor in the AmplitudePool and the PreScreen noise history.
+    std::string _streamKey;
+    // Configuration key of the pooled filter chain.
+    std::string _filterConfig;
+    bool _pooling{false};
+    PreScreen::Config _prescreen;
+    PreScreen::Prediction _prediction{PreScreen::Unscreened};
+
+    struct Provisional {
+        bool enabled{false};
+        // Fraction of the signal window required before publishing.
+        double fraction{0.5};
+        // Seconds of data the running peak must have been unchanged.
+        double stableTime{2.0};
+    };
+
+    // State of the partial signal window, updated record by record.
+    struct ProvisionalState {
+        bool haveNoise{false};
+        double noiseOffset{0};
+        double noiseAmplitude{0};
+        size_t next{0};        // next sample of _data to scan
+        double peak{0};        // running maximum of |data - noiseOffset|
+        size_t peakIndex{0};
+        bool peakChanged{false};  // since the last measurement
+        double published{-1};  // last published amplitude, negative if none
+    };
+
+    // Publishes a provisional amplitude if the partial signal window allows.
+    void emitProvisional(const Seiscomp::Record *record);
+
+    struct AdaptiveWindow {
+        bool enabled{false};
+        // Seconds averaged into the envelope (mean absolute amplitude).
+        double envelopeLength{1.0};
+        // The window ends when the envelope drops below ratio * its maximum ...
+        double ratio{0.3};
+        // ... at least decayTime seconds after the maximum.
+        double decayTime{2.0};
+        // Velocities in km/s predicting the S arrival after the trigger
+        // (P) from the hypocentral distance; the envelope is followed from
+        // there.
+        double pVelocity{6.0};
+        double sVelocity{3.5};
+    };
+
+    // Running envelope of the signal window.
+    struct Envelope {
+        size_t next{0};     // next sample of _data to add
+        double sum{0};
+        double maximum{0};
+        size_t maximumIndex{0};
+    };
+
+    /*
+    Follows the envelope of the filtered signal window from the predicted S
+    arrival on and, once it has decayed after its maximum, shortens the
+    signal window to end at the current sample. Returns whether the window
+    was shortened; it is never extended beyond the configured end, and not
+    shortened at all without a hypocentral distance.
+    */
+    bool adaptWindowEnd();
+
+    // Sets up the chain for initFilter() without the asynchronous handling.
+    void initFilterChain(double fsamp);
+
+    // Returns whether the data covers the time window, otherwise sets the
+    // progress.
+    bool windowComplete();
+
+    // Builds the float equivalent of the MLv filter chain: the prefilter,
+    // if any, followed by the Wood-Anderson simulation.
+    Seiscomp::Math::Filtering::InPlaceFilter<float> *createFloatFilter() const;
+
+    // Appends the float samples not yet in _data to it.
+    void widenFloatData();
+
+    bool _singlePrecision{false};
+    std::unique_ptr<Seiscomp::Math::Filtering::InPlaceFilter<float>> _floatFilter;
+    // The filtered samples in single precision, the counterpart of _data.
+    Seiscomp::FloatArray _floatData;
+
+    static std::string withoutSpaces(const std::string &text)
+    {
+        std::string result;
+        for ( char c : text ) {
+            if ( !isspace(static_cast<unsigned char>(c)) )
+                result += c;
+        }
+        return result;
+    }
+
+    // Samples arrive filtered by the caller, e.g. the lockstep filter of
+    // mla-replay (GA::DSP::LaneFilter), see setExternalFilter().
+    bool _externalFilter{false};
+
+    AdaptiveWindow _adaptive;
+    Envelope _envelope;
+    // Hypocentral distance in km from setEnvironment(), negative if unknown.
+    double _hypocentralDistance{-1};
+
+    Provisional _provisional;
+    ProvisionalState _provisionalState;
+    // Set while a provisional amplitude is computed and published.
+    bool _computingProvisional{false};
+    // Whether this processor warned that updates are disabled.
+    bool _provisionalWarned{false};
+
+    // Key of this processor's amplitude in the AmplitudeCache, covering
+    // everything besides the waveforms the amplitude depends on.
+    std::string cacheKey() const;
+
+    int _cacheSize{0};
+    bool _cacheChecked{false};
+    std::string _cacheKey;
+
+    /*
+    Decimates a record by the integer factor that brings its sampling rate
+    closest to, but not below, the configured rate, and feeds the result.
+    The anti-alias lowpass is linear phase; its delay is taken off the start
+    time, so the decimated samples keep their timing.
+    */
+    bool feedDecimated(const Seiscomp::Record *record);
+
+    // Target sampling rate, 0 disables decimation.
+    double _decimationRate{0};
+    std::unique_ptr<GA::DSP::Decimator> _decimator;
+    double _decimatorInputRate{0};
+    // End time of the last decimated record, for gap detection.
+    Seiscomp::Core::Time _decimatorEnd;
+    std::vector<double> _decimated;
+
+    // Decimates the record if configured, then feeds the base class.
+    bool feedContiguous(const Seiscomp::Record *record);
+
+    /*
+    Feeds records in time order without gaps, so that the filter chain
+    keeps its state instead of starting over. The state at the end of the
+    last contiguous record is the checkpoint: records behind a gap are held
+    back, not filtered, until the missing record arrives or reorderTime
+    seconds of data are held. Then the gap is filled with synthetic samples
+    (a line between the samples around it, or zeros) if it is at most
+    maxGap seconds long; a longer one makes the base class start over as
+    before. Records arriving after their gap was bridged overlap the fed
+    data and are dropped by the base class.
+    */
+    bool feedOrdered(const Seiscomp::Record *record);
+
+    // Feeds a record that continues or overlaps the fed data.
+    bool feedNext(const Seiscomp::Record *record);
+
+    // Feeds the held records that are contiguous, or whose gap waited long
+    // enough. With force all of them.
+    void releaseHeld(bool force);
+
+    // Feeds synthetic samples from the fed data up to next.
+    void bridgeGap(const Seiscomp::Record *next);
+
+    struct Gaps {
+        // Longest gap filled with synthetic samples, in seconds.
+        double maxGap{0};
+        // Fill with a line between the samples around the gap, else zeros.
+        bool interpolate{true};
+        // Seconds of data held behind a gap while waiting for late records.
+        double reorderTime{0};
+    };
+
+    Gaps _gaps;
+    double _gapRate{0};
+    // End time of the fed data and the record it ends with.
+    Seiscomp::Core::Time _nextStart;
+    Seiscomp::RecordCPtr _lastRecord;
+    // Records behind a gap by start time. Of two with the same start time
+    // the longer one is kept.
+    std::map<Seiscomp::Core::Time, Seiscomp::RecordCPtr> _held;
+
+    /*
+    Hands the filtering of the complete, unfiltered window to the
+    AmplitudeExecutor. The buffer and the filter chain belong to the task
+    until its ticket is ready; the amplitude is then computed and published
+    on the feeding thread by finishAsync(), the completion of the ticket, in
+    the order of the pick times of the stream's processors.
+    */
+    void submitAsync(const Seiscomp::Record *record);
+
+    // Filters the buffered window in place, runs on a worker.
+    void filterAsync();
+
+    // Computes and publishes the amplitude of the filtered window, then
+    // feeds the records kept meanwhile.
+    void finishAsync();
+
+    // Waits for an open ticket and drops it along with the kept records.
+    void abandonAsync();
+
+    bool _async{false};
+    // Set once the buffered window has been filtered.
+    bool _asyncFiltered{false};
+    // The filter chain, detached from the stream while samples are
+    // buffered unfiltered.
+    Filter *_asyncFilter{nullptr};
+    // Record that completed the window and its first sample in the buffer.
+    Seiscomp::RecordCPtr _asyncRecord;
+    size_t _asyncTail{0};
+    AmplitudeExecutor::TicketPtr _asyncTicket;
+    // Records fed while the ticket is open.
+    std::vector<Seiscomp::RecordCPtr> _asyncPending;
 };
 
 /*
@@ -101,9 +442,18 @@ regions defined for this magnitude type: West, East, and South. Each region has
 a different formula for calculating the magnitude type associated with it.
 The formula used is the one which corresponds with which region the source
 information is located within. The region extents are defined by a .bna file.
+
+Thread safety: computeStationMagnitudes() keeps its state on the stack and may
+be called from several threads at once, also while computeMagnitude() runs.
+computeMagnitude() itself follows the MagnitudeProcessor interface: the QC
+outcome of a call is read back through treatAsValidMagnitude(), so the pair
+must be serialised by the caller, as scmag does. The per-origin region cache
+it uses is guarded by a mutex.
 */
 class Magnitude_MLA : public Seiscomp::Processing::MagnitudeProcessor
 {
+    DECLARE_SC_CLASS(Magnitude_MLA);
+
     // Typedef the member function pointer for the different formulas of magnitude
     // calculation.
     typedef Seiscomp::Processing::MagnitudeProcessor::Status (Magnitude_MLA::*MagCalc)(
@@ -111,7 +461,7 @@ class Magnitude_MLA : public Seiscomp::Processing::MagnitudeProcessor
         double period,      // in seconds
         double delta,       // in degrees
         double depth,       // in kilometres
-        double &value);
+        double &value) const;
 
     public:
 
@@ -124,6 +474,28 @@ class Magnitude_MLA : public Seiscomp::Processing::MagnitudeProcessor
 
         void setDefaults() override; 
 
+#if SC_API_VERSION >= SC_API_VERSION_CHECK(15,0,0)
+        // Extends the base class setup by indexing the configured MLa
+        // regions for the epicentre lookup.
+        bool setup(const Seiscomp::Processing::Settings &settings) override;
+
+        // Resolves the MLa region of the hypocentre through the region index
+        // instead of the linear polygon scan of the base class, then calls the
+        // locale overload below. Falls back to the base class if the regions
+        // use receiver or path checks, which the index does not handle.
+        Seiscomp::Processing::MagnitudeProcessor::Status computeMagnitude(
+              double amplitudeValue,
+              const std::string &unit,
+              double period,
+              double snr,
+              double delta,
+              double depth,
+              const Seiscomp::DataModel::Origin *hypocenter,
+              const Seiscomp::DataModel::SensorLocation *receiver,
+              const Seiscomp::DataModel::Amplitude *amplitude,
+              double &value) override;
+#endif
+
         // Sets the amplitude type that is being used in the calculation.
         // This method is used to specify what amplitude from scamp is used
         // as the amplitude value passed into the computeMagnitude method for
@@ -160,6 +532,61 @@ class Magnitude_MLA : public Seiscomp::Processing::MagnitudeProcessor
 #endif
               double &value) override;
 
+        // Inputs of one station magnitude computation.
+        struct StationInput {
+            double amplitude;   // in millimetres
+            double period;      // in seconds
+            double snr;
+            double delta;       // in degrees
+            double depth;       // in kilometres
+        };
+
+        // Outcome of one station magnitude computation. treatAsValid is set
+        // when the station magnitude should be kept despite a non-OK status,
+        // flagged as failing QC (currently: SNR below the minimum).
+        struct StationMagnitude {
+            Seiscomp::Processing::MagnitudeProcessor::Status status{Error};
+            double value{0};
+            bool treatAsValid{false};
+        };
+
+#if SC_API_VERSION >= SC_API_VERSION_CHECK(15,0,0)
+        /*
+        Computes the station magnitudes of one origin. The region is resolved
+        once and the stations are evaluated on the worker pool configured with
+        magnitudes.<type>.threads (on the calling thread if not configured).
+        The result has one entry per input, in input order, whatever the
+        number of threads.
+
+        Requires regions that can be resolved from the epicentre alone;
+        otherwise every entry has status Error. Virtual, so that applications
+        which load the plugin at runtime (mla-replay) can call it without
+        linking against it.
+        */
+        virtual std::vector<StationMagnitude> computeStationMagnitudes(
+              const Seiscomp::DataModel::Origin *hypocenter,
+              const std::vector<StationInput> &stations) const;
+
+        /*
+        Computes the station magnitudes of several amplitude types of one
+        origin in one pass, e.g. of MLa, MLa01, MLa05 and MLa075. stations
+        holds types consecutive entries per station, one per type in the
+        same order for every station; delta and depth of the first entry of
+        a station apply to all of its entries. The region limits, the
+        hypocentral distance and its correction are evaluated once per
+        station and the correction is added to the log10 of every amplitude
+        of the station, which gives the same values as
+        computeStationMagnitudes() per type. The regions, limits and minimum
+        SNR of this processor apply to all types. A missing amplitude (0)
+        gives AmplitudeOutOfRange for its entry. The result has the layout
+        of stations.
+        */
+        virtual std::vector<StationMagnitude> computeStationMagnitudes(
+              const Seiscomp::DataModel::Origin *hypocenter,
+              const std::vector<StationInput> &stations,
+              size_t types) const;
+#endif
+
         /*#####################################################################
                                             STATIC METHODS
         #####################################################################*/
@@ -174,6 +601,37 @@ class Magnitude_MLA : public Seiscomp::Processing::MagnitudeProcessor
         */
         static double distance(double delta, double depth);
 
+        /*
+        The distance corrections (-log A0 terms) of the regional formulas, i.e.
+        the magnitude of a 1 mm amplitude at hypocentral distance r:
+            West:  1.137log10(R)+0.000657*R+0.66
+            East:  1.34log10(R/100)+0.00055*(R-100)+3.13
+            South: 1.1log10(R)+0.0013*R+0.7
+        The formulas live in GA::Core::MLa (libs/ga/core), which has no
+        SeisComP dependencies.
+
+        @param r: hypocentral distance (in kms), see distance().
+        */
+        static double correctionWest(double r);
+        static double correctionEast(double r);
+        static double correctionSouth(double r);
+
+        /*
+        The smallest correction of all regions at distance r. A magnitude M
+        can not produce an MLa amplitude above 10^(M - smallestCorrection(r))
+        in any region.
+        */
+        static double smallestCorrection(double r);
+
+#if SC_API_VERSION >= SC_API_VERSION_CHECK(15,0,0)
+    protected:
+
+        // Records every configured region so it can be indexed in setup().
+        bool initLocale(Locale *locale,
+                        const Seiscomp::Processing::Settings &settings,
+                        const std::string &configPrefix) override;
+#endif
+
     private:
 
         /*#####################################################################
@@ -182,6 +640,31 @@ class Magnitude_MLA : public Seiscomp::Processing::MagnitudeProcessor
 
         static std::map<std::string, MagCalc> regionToCalcMap;
 
+#if SC_API_VERSION >= SC_API_VERSION_CHECK(15,0,0)
+        // Region resolved for the most recent origin.
+        struct OriginRegion {
+            std::string originID;
+            double lat{0};
+            double lon{0};
+            size_t region{GA::Geo::FeatureIndex::npos};
+            bool valid{false};
+        };
+
+        // Copies of the configured regions in configuration order. The
+        // position in this list is the dense region ID used to index
+        // _regionCalcs (nullptr for unknown region names).
+        std::vector<Locale> _regions;
+        std::vector<MagCalc> _regionCalcs;
+        GA::Geo::FeatureIndex _regionIndex;
+        OriginRegion _originRegion;
+        std::mutex _originRegionMutex;
+        // False if any region cannot be resolved from the epicentre alone.
+        bool _indexedLookup{true};
+        // Workers of computeStationMagnitudes(), nullptr for the calling
+        // thread only.
+        std::shared_ptr<WorkerPool> _pool;
+#endif
+
         /*#####################################################################
                                                 PRIVATE METHODS
         #####################################################################*/
@@ -192,6 +675,44 @@ class Magnitude_MLA : public Seiscomp::Processing::MagnitudeProcessor
         */
         void setupRegionToCalc();
 
+#if SC_API_VERSION >= SC_API_VERSION_CHECK(15,0,0)
+        /*
+        Returns the region ID of the epicentre, or FeatureIndex::npos if it is
+        outside all regions. The result is cached per origin (publicID and
+        location), so the polygon test runs once per origin rather than once
+        per station magnitude. computeStationMagnitudes() does not use it.
+        */
+        size_t originRegion(const std::string &originID, double lat, double lon);
+
+        // Applies the limits of a region to a station, returns OK if they pass.
+        Seiscomp::Processing::MagnitudeProcessor::Status checkRegionLimits(
+              size_t region, double delta, double depth) const;
+#endif
+
+        /*
+        Evaluates a regional formula and the minimum SNR check shared by all
+        regions. Reentrant: reports the QC outcome in the result instead of
+        through _treatAsValidMagnitude.
+        */
+        StationMagnitude evaluate(MagCalc calcFunction, const StationInput &input) const;
+
+        // The minimum SNR check of evaluate(): flags result as failing QC.
+        void checkSNR(double snr, StationMagnitude &result) const;
+
+        /*
+        Applies evaluate() for the MagnitudeProcessor interface: stores the QC
+        outcome in _treatAsValidMagnitude, which magtool queries through
+        treatAsValidMagnitude() after a non-OK status.
+        */
+        Seiscomp::Processing::MagnitudeProcessor::Status applyFormula(
+              MagCalc calcFunction,
+              double amplitudeValue, // in millimetres
+              double period,         // in seconds
+              double snr,
+              double delta,          // in degrees
+              double depth,          // in kilometres
+              double &value);
+
         /*
         Calculates the ml magnitude for the west region (Western Australia).
         The formula for this region is as follows:
@@ -211,7 +732,7 @@ class Magnitude_MLA : public Seiscomp::Processing::MagnitudeProcessor
 		      double period,      // in seconds
 		      double delta,       // in degrees
 		      double depth,       // in kilometres
-		      double &value);
+		      double &value) const;
 
         /*
         Calculates the ml magnitude for the east region (Eastern Australia).
@@ -233,7 +754,7 @@ class Magnitude_MLA : public Seiscomp::Processing::MagnitudeProcessor
 		      double period,      // in seconds
 		      double delta,       // in degrees
 		      double depth,       // in kilometres
-		      double &value);
+		      double &value) const;
 
         /*
         Calculates the ml magnitude for the south region (Flinders Ranges).
@@ -255,7 +776,7 @@ class Magnitude_MLA : public Seiscomp::Processing::MagnitudeProcessor
 		      double period,      // in seconds
 		      double delta,       // in degrees
 		      double depth,       // in kilometres
-		      double &value);
+		      double &value) const;
 
 };
 
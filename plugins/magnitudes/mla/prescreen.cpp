@@ -0,0 +1,116 @@
+#define SEISCOMP_COMPONENT MLa
+
+#include "prescreen.h"
+#include "mla.h"
+
+#include <seiscomp/logging/log.h>
+
+#include <algorithm>
+#include <math.h>
+
+namespace {
+
+// Weight of the newest observation in the noise average.
+const double NoiseWeight = 0.3;
+
+}
+
+PreScreen &PreScreen::Instance()
+{
+    static PreScreen screen;
+    return screen;
+}
+
+PreScreen::Prediction PreScreen::predict(const std::string &stream, const Config &config,
+                                         double magnitude, double r, double time,
+                                         double *expectedSNR)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto it = _history.find(stream);
+    if ( it != _history.end() && config.maxAge > 0 &&
+         fabs(time - it->second.updated) > config.maxAge ) {
+        // Stale: process the stream to measure its noise again
+        _history.erase(it);
+        it = _history.end();
+    }
+
+    if ( it == _history.end() || it->second.noise <= 0 ) {
+        ++_stats.unscreened;
+        return Unscreened;
+    }
+
+    const double amplitude = pow(10.0, magnitude - Magnitude_MLA::smallestCorrection(r));
+    *expectedSNR = amplitude / it->second.noise;
+
+    ++_stats.screened;
+    if ( _stats.screened % 100 == 0 )
+        report();
+
+    return *expectedSNR < config.margin * config.minimumSNR ? Fail : Pass;
+}
+
+bool PreScreen::audit(const std::string &stream, const Config &config)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto it = _history.find(stream);
+    if ( it != _history.end() && config.auditInterval > 0 &&
+         ++it->second.rejections >= config.auditInterval ) {
+        it->second.rejections = 0;
+        ++_stats.audited;
+        return true;
+    }
+
+    ++_stats.skipped;
+    return false;
+}
+
+void PreScreen::recordResult(const std::string &stream, const Config &config,
+                             Prediction prediction, double time,
+                             double amplitude, double snr)
+{
+    if ( snr <= 0 || amplitude <= 0 )
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const double noise = amplitude / snr;
+    History &history = _history[stream];
+    if ( history.noise > 0 )
+        history.noise = (1 - NoiseWeight) * history.noise + NoiseWeight * noise;
+    else
+        history.noise = noise;
+    history.updated = std::max(history.updated, time);
+
+    if ( prediction == Unscreened )
+        return;
+
+    const bool passed = snr >= config.minimumSNR;
+    if ( prediction == Fail && passed )
+        ++_stats.falseRejects;
+    else if ( prediction == Pass && !passed )
+        ++_stats.falseAccepts;
+    else
+        ++_stats.agreed;
+}
+
+PreScreen::Statistics PreScreen::statistics() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+void PreScreen::report() const
+{
+    SEISCOMP_INFO("MLa pre-screen: %llu screened, %llu unscreened, %llu skipped, "
+                  "%llu audited; full result agreed %llu, false rejects %llu, "
+                  "false accepts %llu",
+                  static_cast<unsigned long long>(_stats.screened),
+                  static_cast<unsigned long long>(_stats.unscreened),
+                  static_cast<unsigned long long>(_stats.skipped),
+                  static_cast<unsigned long long>(_stats.audited),
+                  static_cast<unsigned long long>(_stats.agreed),
+                  static_cast<unsigned long long>(_stats.falseRejects),
+                  static_cast<unsigned long long>(_stats.falseAccepts));
+}
@@ -0,0 +1,109 @@
+/*
+ * File:   prescreen.h
+ */
+
+#ifndef __MLA_PRESCREEN_H__
+#define __MLA_PRESCREEN_H__
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+/*
+Cheap estimate of whether a stream can produce an MLa amplitude that passes
+the magnitude SNR check, made before any waveform is processed.
+
+The expected amplitude comes from the origin's provisional magnitude and the
+most favourable regional distance correction, the expected noise from the
+noise level of the previous amplitudes of the same stream (amplitude / SNR,
+exponentially averaged). Streams whose expected SNR falls below
+margin * minimumSNR can be skipped.
+
+A skipped stream does not update its noise history. So that a stream is not
+skipped forever on a noise level that no longer holds, a history older than
+maxAge (by pick time) is dropped and the stream is processed again, and every
+auditInterval-th rejection of the same stream is processed anyway. Every
+processed stream with a prediction is compared against the SNR of the full
+result to measure how often the screen is wrong.
+*/
+class PreScreen
+{
+public:
+    struct Config {
+        bool enabled{false};
+        // Origin magnitude used as the provisional magnitude.
+        std::string magnitudeType{"MLa"};
+        // SNR the magnitude processor requires (Magnitude_MLA: 2.0).
+        double minimumSNR{2.0};
+        // Safety factor applied to minimumSNR before rejecting a stream.
+        double margin{0.5};
+        // Every n-th rejection of a stream is processed anyway, 0 disables
+        // audits.
+        int auditInterval{10};
+        // Seconds of pick time after which a noise history is dropped,
+        // 0 keeps it forever.
+        double maxAge{86400};
+    };
+
+    enum Prediction {
+        Unscreened, // no provisional magnitude or current noise history
+        Pass,
+        Fail
+    };
+
+    struct Statistics {
+        uint64_t screened{0};    // streams with a prediction
+        uint64_t unscreened{0};  // streams without a prediction
+        uint64_t skipped{0};     // rejected streams that were not processed
+        uint64_t audited{0};     // rejected streams processed anyway
+        uint64_t agreed{0};      // predictions confirmed by the full result
+        uint64_t falseRejects{0};  // predicted to fail but passed
+        uint64_t falseAccepts{0};  // predicted to pass but failed
+    };
+
+    static PreScreen &Instance();
+
+    /*
+    Predicts the outcome for a stream.
+    @param stream: stream and amplitude type key of the noise history.
+    @param magnitude: provisional magnitude of the origin.
+    @param r: hypocentral distance in km.
+    @param time: pick time in seconds, to expire the noise history.
+    @param expectedSNR: set to the expected SNR if a prediction was made.
+    */
+    Prediction predict(const std::string &stream, const Config &config,
+                       double magnitude, double r, double time,
+                       double *expectedSNR);
+
+    // Returns whether a rejected stream should be processed anyway (audit),
+    // otherwise counts it as skipped.
+    bool audit(const std::string &stream, const Config &config);
+
+    // Updates the noise history of a stream with the result for the pick at
+    // time and compares the prediction made for it with the full result.
+    void recordResult(const std::string &stream, const Config &config,
+                      Prediction prediction, double time,
+                      double amplitude, double snr);
+
+    Statistics statistics() const;
+
+private:
+    PreScreen() = default;
+
+    void report() const;
+
+    struct History {
+        double noise{0};
+        // Pick time of the last update
+        double updated{0};
+        // Rejections since the last audit
+        int rejections{0};
+    };
+
+    mutable std::mutex _mutex;
+    std::map<std::string, History> _history;
+    Statistics _stats;
+};
+
+#endif /* __MLA_PRESCREEN_H__ */
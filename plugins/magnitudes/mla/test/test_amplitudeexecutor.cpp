@@ -0,0 +1,89 @@
+#include "../amplitudeexecutor.h"
+
+#include <ga/test/check.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void testCompletionOrder()
+{
+    AmplitudeExecutor &executor = AmplitudeExecutor::Instance();
+    std::vector<std::string> published;
+    std::atomic<bool> slow { true };
+
+    // The first ticket of stream A finishes last
+    AmplitudeExecutor::TicketPtr a1, a2, b1;
+    a1 = executor.submit("A",
+                         [&]() {
+                             while ( slow )
+                                 std::this_thread::yield();
+                         },
+                         [&]() { published.push_back("A1"); executor.release(*a1); });
+    a2 = executor.submit("A", []() {},
+                         [&]() { published.push_back("A2"); executor.release(*a2); });
+    b1 = executor.submit("B", []() {},
+                         [&]() { published.push_back("B1"); executor.release(*b1); });
+
+    executor.wait(*a2);
+    executor.wait(*b1);
+    executor.runCompleted();
+    GA_CHECK((published == std::vector<std::string> { "B1" }));
+    GA_CHECK(!executor.ready(*a2));
+
+    slow = false;
+    executor.wait(*a1);
+    executor.runCompleted();
+    GA_CHECK((published == std::vector<std::string> { "B1", "A1", "A2" }));
+}
+
+void testReleasedTicket()
+{
+    AmplitudeExecutor &executor = AmplitudeExecutor::Instance();
+    int completions = 0;
+
+    // A processor destroyed before publishing releases its ticket, the
+    // completion must not run
+    AmplitudeExecutor::TicketPtr ticket
+        = executor.submit("C", []() {}, [&]() { ++completions; });
+    executor.wait(*ticket);
+    executor.release(*ticket);
+    executor.runCompleted();
+    GA_CHECK(completions == 0);
+}
+
+void testCompletionRunsOnce()
+{
+    AmplitudeExecutor &executor = AmplitudeExecutor::Instance();
+    int completions = 0;
+
+    // A completion that does not release its ticket runs only once, and
+    // one calling runCompleted() again does not recurse
+    AmplitudeExecutor::TicketPtr ticket;
+    ticket = executor.submit("D", []() {}, [&]() {
+        ++completions;
+        executor.runCompleted();
+    });
+    executor.wait(*ticket);
+    executor.runCompleted();
+    executor.runCompleted();
+    GA_CHECK(completions == 1);
+    GA_CHECK(executor.ready(*ticket));
+
+    executor.release(*ticket);
+    GA_CHECK(!executor.ready(*ticket));
+}
+
+} // namespace
+
+int main()
+{
+    AmplitudeExecutor::Instance().configure(2, 8);
+    testCompletionOrder();
+    testReleasedTicket();
+    testCompletionRunsOnce();
+    return GA::Test::result();
+}
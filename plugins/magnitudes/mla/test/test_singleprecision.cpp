@@ -0,0 +1,108 @@
+#include "../mla.h"
+
+#include <ga/test/check.h>
+
+#include <seiscomp/config/config.h>
+#include <seiscomp/core/genericrecord.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+const double SamplingRate = 100.0;
+const double Gain = 1e9;   // counts per m/s
+
+/*
+Velocity in m/s of a station 60 km from a small event: low noise, then a
+decaying 2 Hz burst starting 5 s after the pick, on a slow drift the 0.5 Hz
+prefilter has to remove.
+*/
+std::vector<double> trace(size_t n, double pickOffset)
+{
+    std::mt19937 random(4711);
+    std::normal_distribution<double> noise(0.0, 1e-8);
+
+    std::vector<double> samples(n);
+    for ( size_t i = 0; i < n; ++i ) {
+        const double t = i / SamplingRate - pickOffset - 5.0;
+        samples[i] = noise(random) + 1e-6 * std::sin(2 * M_PI * 0.02 * i / SamplingRate);
+        if ( t > 0 )
+            samples[i] += 2e-5 * t * std::exp(-t / 2.0) * std::sin(2 * M_PI * 2.0 * t);
+    }
+    return samples;
+}
+
+/*
+Runs a processor over the trace in one second records and returns the
+amplitudes it publishes.
+*/
+std::vector<double> replay(bool singlePrecision)
+{
+    const Seiscomp::Core::Time start = Seiscomp::Core::Time::FromString("2024-01-01 00:00:00", "%F %T");
+    const double pickOffset = 40.0;
+    const Seiscomp::Core::Time pick = start + Seiscomp::Core::TimeSpan(pickOffset);
+
+    Seiscomp::Config::Config config;
+    config.setString("amplitudes.MLa.filter", "BW_HP(3, 0.5)");
+    config.setString("amplitudes.MLa.signalEnd", "30");
+    config.setBool("amplitudes.MLa.singlePrecision", singlePrecision);
+
+    Amplitude_MLA proc;
+    Seiscomp::Processing::Stream &stream =
+        proc.streamConfig(Seiscomp::Processing::WaveformProcessor::VerticalComponent);
+    stream.init("AU", "TEST", "", "HHZ", pick);
+    stream.gain = Gain;
+    stream.gainUnit = "M/S";
+
+    Seiscomp::Processing::Settings settings("scamp", "AU", "TEST", "", "HHZ", &config, nullptr);
+    if ( !GA_CHECK(proc.setup(settings)) )
+        return {};
+
+    std::vector<double> published;
+    proc.setTrigger(pick);
+    proc.computeTimeWindow();
+    proc.setPublishFunction([&](const Seiscomp::Processing::AmplitudeProcessor *,
+                                const Seiscomp::Processing::AmplitudeProcessor::Result &result) {
+        published.push_back(result.amplitude.value);
+    });
+
+    const std::vector<double> velocity = trace(static_cast<size_t>(90 * SamplingRate), pickOffset);
+    const size_t perRecord = static_cast<size_t>(SamplingRate);
+    for ( size_t i = 0; i + perRecord <= velocity.size() && !proc.isFinished(); i += perRecord ) {
+        std::vector<double> counts(perRecord);
+        for ( size_t j = 0; j < perRecord; ++j )
+            counts[j] = velocity[i + j] * Gain;
+
+        Seiscomp::GenericRecordPtr record = new Seiscomp::GenericRecord(
+            "AU", "TEST", "", "HHZ", start + Seiscomp::Core::TimeSpan(i / SamplingRate),
+            SamplingRate);
+        record->setData(new Seiscomp::DoubleArray(static_cast<int>(perRecord), counts.data()));
+        record->dataUpdated();
+        proc.feed(record.get());
+    }
+
+    GA_CHECK(proc.isFinished());
+    return published;
+}
+
+void testSingleMatchesDouble()
+{
+    const std::vector<double> reference = replay(false);
+    const std::vector<double> single = replay(true);
+    if ( !GA_CHECK(reference.size() == 1) || !GA_CHECK(single.size() == 1) )
+        return;
+
+    GA_CHECK(reference[0] > 0 && single[0] > 0);
+    // Magnitude units: float rounding of the filter states only
+    GA_CHECK_CLOSE(std::log10(single[0]), std::log10(reference[0]), 0.001);
+}
+
+} // namespace
+
+int main()
+{
+    testSingleMatchesDouble();
+    return GA::Test::result();
+}
@@ -0,0 +1,62 @@
+#include "../workerpool.h"
+
+#include <ga/test/check.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+void testAllIndices()
+{
+    WorkerPool pool(3);
+    std::vector<int> calls(1000, 0);
+    pool.parallelFor(calls.size(), [&](size_t i) { ++calls[i]; });
+
+    bool once = true;
+    for ( int c : calls )
+        once = once && c == 1;
+    GA_CHECK(once);
+}
+
+void testHelperThrows()
+{
+    WorkerPool pool(4);
+    std::atomic<size_t> calls { 0 };
+
+    // Every index but the first throws, so helpers and the calling thread
+    // both run into exceptions; parallelFor must return instead of waiting
+    // for the helpers forever.
+    GA_CHECK_THROWS(pool.parallelFor(100,
+                        [&](size_t i) {
+                            ++calls;
+                            if ( i > 0 )
+                                throw std::runtime_error("index");
+                        }),
+        std::runtime_error);
+    GA_CHECK(calls <= 100);
+
+    // The pool is still usable
+    std::atomic<size_t> sum { 0 };
+    pool.parallelFor(10, [&](size_t i) { sum += i; });
+    GA_CHECK(sum == 45);
+}
+
+void testCallerThrows()
+{
+    // Without workers the calling thread runs every index
+    WorkerPool pool(0);
+    GA_CHECK_THROWS(pool.parallelFor(5, [](size_t) { throw std::logic_error("caller"); }),
+        std::logic_error);
+}
+
+} // namespace
+
+int main()
+{
+    testAllIndices();
+    testHelperThrows();
+    testCallerThrows();
+    return GA::Test::result();
+}
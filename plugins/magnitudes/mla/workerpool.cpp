@@ -0,0 +1,109 @@
+#define SEISCOMP_COMPONENT MLa
+
+#include "workerpool.h"
+
+#include <seiscomp/logging/log.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+WorkerPool::WorkerPool(size_t threads)
+{
+    for ( size_t i = 0; i < threads; ++i )
+        _threads.emplace_back(&WorkerPool::run, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wakeup.notify_all();
+    for ( auto &t : _threads )
+        t.join();
+}
+
+void WorkerPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(std::move(task));
+    }
+    _wakeup.notify_one();
+}
+
+void WorkerPool::run()
+{
+    for ( ;; ) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wakeup.wait(lock, [this] { return _stopping || !_queue.empty(); });
+            // Drain the queue before stopping so no submitted task is lost
+            if ( _queue.empty() )
+                return;
+            task = std::move(_queue.front());
+            _queue.pop_front();
+        }
+
+        try {
+            task();
+        }
+        catch ( const std::exception &e ) {
+            SEISCOMP_ERROR("Worker task failed: %s", e.what());
+        }
+        catch ( ... ) {
+            SEISCOMP_ERROR("Worker task failed with an unknown exception");
+        }
+    }
+}
+
+void WorkerPool::parallelFor(size_t n, const std::function<void(size_t)> &fn)
+{
+    if ( n == 0 )
+        return;
+
+    std::atomic<size_t> next{0};
+    std::mutex doneMutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+
+    // Exceptions must not leave work(): the helpers reference this frame
+    // until pending drops to zero. The first one stops handing out indices
+    // and is rethrown once all helpers have finished.
+    auto work = [&]() {
+        try {
+            for ( size_t i = next++; i < n; i = next++ )
+                fn(i);
+        }
+        catch ( ... ) {
+            next = n;
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if ( !error )
+                error = std::current_exception();
+        }
+    };
+
+    // One helper per worker, but never more helpers than indices beyond the
+    // first, which the calling thread takes itself.
+    const size_t helpers = std::min(_threads.size(), n - 1);
+    size_t pending = helpers;
+
+    for ( size_t h = 0; h < helpers; ++h ) {
+        submit([&]() {
+            work();
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if ( --pending == 0 )
+                done.notify_one();
+        });
+    }
+
+    work();
+
+    std::unique_lock<std::mutex> lock(doneMutex);
+    done.wait(lock, [&] { return pending == 0; });
+    if ( error )
+        std::rethrow_exception(error);
+}
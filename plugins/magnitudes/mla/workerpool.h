@@ -0,0 +1,56 @@
+/*
+ * File:   workerpool.h
+ */
+
+#ifndef __MLA_WORKERPOOL_H__
+#define __MLA_WORKERPOOL_H__
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+Fixed-size pool of worker threads executing queued tasks in FIFO order.
+An exception escaping a task passed to submit() is logged and dropped, the
+worker carries on with the next task. parallelFor() instead hands the first
+exception of fn back to its caller.
+*/
+class WorkerPool
+{
+public:
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    // Number of worker threads.
+    size_t size() const { return _threads.size(); }
+
+    // Queues a task for execution on one of the workers.
+    void submit(std::function<void()> task);
+
+    /*
+    Runs fn(i) for every i in [0, n) on the workers and the calling thread
+    and returns once all calls have finished. Indices are handed out
+    dynamically, so fn must only write to per-index state for the result to
+    be deterministic. If fn throws, the remaining indices are skipped and the
+    first exception is rethrown once every call in progress has returned.
+    */
+    void parallelFor(size_t n, const std::function<void(size_t)> &fn);
+
+private:
+    void run();
+
+    std::vector<std::thread> _threads;
+    std::deque<std::function<void()>> _queue;
+    std::mutex _mutex;
+    std::condition_variable _wakeup;
+    bool _stopping{false};
+};
+
+#endif /* __MLA_WORKERPOOL_H__ */